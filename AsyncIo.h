@@ -0,0 +1,196 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define an asynchronous file I/O engine, which lets one thread keep many
+ * reads and writes in flight at once. Requests are queued with SSC_AsyncIo_prepare(), handed
+ * to the engine in batches with SSC_AsyncIo_submit(), and their results are collected in
+ * batches with SSC_AsyncIo_reap(), in whatever order they finish.
+ *
+ * On Linux the engine is backed by io_uring, so that a whole batch costs one system call.
+ * Where io_uring is unavailable (other systems, kernels older than 5.1, or sandboxes that
+ * forbid it), it falls back to a pool of threads performing positional reads and writes;
+ * the interface and results are the same either way. */
+#ifndef SSC_ASYNCIO_H
+#define SSC_ASYNCIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Error.h"
+#include "File.h"
+#include "Macro.h"
+
+#define SSC_ASYNCIO_MAX_DEPTH 4096       /* The most requests an engine may hold at once. */
+#define SSC_ASYNCIO_MAX_SIZE  0x7ffff000 /* The most bytes one request may transfer. */
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Backends */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_ASYNCIO_BACKEND_NONE    = 0,
+  SSC_ASYNCIO_BACKEND_URING   = 1, /* Linux io_uring. */
+  SSC_ASYNCIO_BACKEND_THREADS = 2, /* A pool of threads doing positional I/O. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Async I/O Engine
+ *   An engine belongs to the thread that created it; it must not be used by several
+ *   threads at once. @depth requests may be held at once, whether prepared, in flight,
+ *   or finished but not yet reaped. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  void*    engine;   /* The backend's state. */
+  unsigned depth;    /* The most requests that may be held at once. */
+  unsigned pending;  /* The number of requests prepared, but not yet submitted. */
+  unsigned inflight; /* The number of requests submitted, but not yet reaped. */
+  int      backend;  /* One of SSC_ASYNCIO_BACKEND_*. */
+} SSC_AsyncIo;
+#define SSC_ASYNCIO_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_AsyncIo, SSC_NULL, 0, 0, 0, SSC_ASYNCIO_BACKEND_NONE)
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Request Operations */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_ASYNCIO_OP_READ  = 0, /* Read @size bytes at @offset into @buf. */
+  SSC_ASYNCIO_OP_WRITE = 1, /* Write the @size bytes at @buf at @offset. */
+  SSC_ASYNCIO_OP_FSYNC = 2, /* Flush the file's data and metadata to storage. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Request Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  /* Use the file registered at @file_index, rather than @file.
+   * See SSC_AsyncIo_registerFiles(). */
+  SSC_ASYNCIO_REQ_FIXED_FILE   = 0x01,
+  /* @buf lies within the buffer registered at @buf_index, which io_uring keeps pinned,
+   * sparing it from mapping the pages on every request. See SSC_AsyncIo_registerBuffers(). */
+  SSC_ASYNCIO_REQ_FIXED_BUFFER = 0x02,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Requests and Completions */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  uint64_t      user;       /* Returned untouched in the request's completion. */
+  void*         buf;        /* Must stay valid until the request is reaped. */
+  size_t        size;       /* At most SSC_ASYNCIO_MAX_SIZE. */
+  size_t        offset;
+  SSC_File_t    file;
+  unsigned      file_index; /* With SSC_ASYNCIO_REQ_FIXED_FILE. */
+  unsigned      buf_index;  /* With SSC_ASYNCIO_REQ_FIXED_BUFFER. */
+  int           op;         /* One of SSC_ASYNCIO_OP_*. */
+  SSC_BitFlag_t flags;      /* SSC_ASYNCIO_REQ_* */
+} SSC_AsyncIoRequest;
+
+typedef struct {
+  uint64_t user;   /* The @user of the finished request. */
+  int64_t  result; /* The number of bytes transferred, or a negative value on failure:
+                    * the negated errno value on Unixlikes, or of GetLastError() on Windows.
+                    * As with pread(), a read may fall short, most often at the end of the file. */
+} SSC_AsyncIoCompletion;
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  /* Use the thread pool, even where io_uring is available. */
+  SSC_ASYNCIO_INIT_THREADS = 0x01,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Error Codes
+ *     SSC_CodeError_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_ASYNCIO_INIT_CODE_OK          =  0,
+  SSC_ASYNCIO_INIT_CODE_ERR_DEPTH   = -1, /* @depth is 0, or above SSC_ASYNCIO_MAX_DEPTH. */
+  SSC_ASYNCIO_INIT_CODE_ERR_ALLOC   = -2, /* Failed to allocate memory. */
+  SSC_ASYNCIO_INIT_CODE_ERR_THREADS = -3, /* Failed to start the thread pool. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Create an engine that holds up to @depth requests. When the thread pool backs it, it runs
+ * @threads threads, or one per processor when @threads is 0, but never more than @depth. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_AsyncIo_init(SSC_AsyncIo* aio, unsigned depth, unsigned threads, SSC_BitFlag_t flags);
+
+SSC_API void
+SSC_AsyncIo_initOrDie(SSC_AsyncIo* aio, unsigned depth, unsigned threads, SSC_BitFlag_t flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Registration
+ *   Register files and buffers once, so that requests naming them skip per-request setup.
+ *   Registering replaces whatever was registered before, and registering 0 of them
+ *   unregisters them all. Nothing may be in flight, or pending, while registering. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Register the @count files at @files, by their index into @files. */
+SSC_API SSC_Error_t
+SSC_AsyncIo_registerFiles(SSC_AsyncIo* R_ aio, const SSC_File_t* R_ files, unsigned count);
+
+/* Register the @count buffers described by @bufs, by their index into @bufs.
+ * io_uring pins registered buffers, charging them against RLIMIT_MEMLOCK. */
+SSC_API SSC_Error_t
+SSC_AsyncIo_registerBuffers(SSC_AsyncIo* R_ aio, const SSC_IoVec* R_ bufs, unsigned count);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Submission and Completion */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Return the number of requests that may be prepared before some must be reaped. */
+SSC_INLINE unsigned
+SSC_AsyncIo_getFree(const SSC_AsyncIo* aio)
+{
+  return aio->depth - aio->pending - aio->inflight;
+}
+
+/* Queue a copy of @req, to be started by the next SSC_AsyncIo_submit().
+ * Fails when the engine is full, or @req is invalid. */
+SSC_API SSC_Error_t
+SSC_AsyncIo_prepare(SSC_AsyncIo* R_ aio, const SSC_AsyncIoRequest* R_ req);
+
+/* Start every prepared request. Once submitted, requests count as in flight even when this
+ * fails: any the kernel did not take up stay queued in the submission ring, and are handed
+ * to it again by the next SSC_AsyncIo_submit() or SSC_AsyncIo_reap(). */
+SSC_API SSC_Error_t
+SSC_AsyncIo_submit(SSC_AsyncIo* aio);
+
+SSC_INLINE void
+SSC_AsyncIo_submitOrDie(SSC_AsyncIo* aio)
+{
+  SSC_assertMsg(!SSC_AsyncIo_submit(aio), "Error: SSC_AsyncIo_submit() failed!\n");
+}
+
+/* Store the completions of up to @max finished requests in @completions, waiting until at
+ * least @min have finished (or as many as are in flight, when fewer), and store their number
+ * in @count. With @min 0, never wait. */
+SSC_API SSC_Error_t
+SSC_AsyncIo_reap(SSC_AsyncIo* R_ aio, SSC_AsyncIoCompletion* R_ completions, unsigned max, unsigned min, unsigned* R_ count);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Wait for requests in flight to finish, then free the engine. Pending requests are dropped. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void
+SSC_AsyncIo_del(SSC_AsyncIo* aio);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_ASYNCIO_H */
@@ -0,0 +1,129 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define atomic operations on unsigned integers shared between threads,
+ * or between processes through shared memory.
+ * Loads have acquire semantics, stores have release semantics, and
+ * read-modify-write operations are sequentially consistent. */
+#ifndef SSC_ATOMIC_H
+#define SSC_ATOMIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Macro.h"
+
+#if   SSC_COMPILER_IS_GCC_COMPATIBLE
+ #define SSC_ATOMIC_LOAD_IMPL(Ptr)      { return __atomic_load_n(Ptr, __ATOMIC_ACQUIRE); }
+ #define SSC_ATOMIC_STORE_IMPL(Ptr, V)  { __atomic_store_n(Ptr, V, __ATOMIC_RELEASE); }
+ #define SSC_ATOMIC_FETCHADD_IMPL(Ptr, V) { return __atomic_fetch_add(Ptr, V, __ATOMIC_SEQ_CST); }
+ #define SSC_ATOMIC_CMPXCHG_IMPL(Ptr, Expected, Desired) {\
+  return __atomic_compare_exchange_n(Ptr, Expected, Desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);\
+ }
+ #define SSC_ATOMIC_LOAD32_IMPL(Ptr)                        SSC_ATOMIC_LOAD_IMPL(Ptr)
+ #define SSC_ATOMIC_STORE32_IMPL(Ptr, V)                    SSC_ATOMIC_STORE_IMPL(Ptr, V)
+ #define SSC_ATOMIC_LOAD64_IMPL(Ptr)                        SSC_ATOMIC_LOAD_IMPL(Ptr)
+ #define SSC_ATOMIC_STORE64_IMPL(Ptr, V)                    SSC_ATOMIC_STORE_IMPL(Ptr, V)
+ #define SSC_ATOMIC_FETCHADD64_IMPL(Ptr, V)                 SSC_ATOMIC_FETCHADD_IMPL(Ptr, V)
+ #define SSC_ATOMIC_CMPXCHG64_IMPL(Ptr, Expected, Desired)  SSC_ATOMIC_CMPXCHG_IMPL(Ptr, Expected, Desired)
+ #define SSC_ATOMIC_LOADSIZE_IMPL(Ptr)                      SSC_ATOMIC_LOAD_IMPL(Ptr)
+ #define SSC_ATOMIC_STORESIZE_IMPL(Ptr, V)                  SSC_ATOMIC_STORE_IMPL(Ptr, V)
+ #define SSC_ATOMIC_FETCHADDSIZE_IMPL(Ptr, V)               SSC_ATOMIC_FETCHADD_IMPL(Ptr, V)
+#elif SSC_COMPILER == SSC_COMPILER_MSVC
+ #include <intrin.h>
+ /* The Interlocked* intrinsics are full barriers. */
+ #define SSC_ATOMIC_LOAD32_IMPL(Ptr) {\
+  return (uint32_t)_InterlockedCompareExchange((volatile long*)(Ptr), 0, 0);\
+ }
+ #define SSC_ATOMIC_STORE32_IMPL(Ptr, V) {\
+  _InterlockedExchange((volatile long*)(Ptr), (long)(V));\
+ }
+ #define SSC_ATOMIC_LOAD64_IMPL(Ptr) {\
+  return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)(Ptr), 0, 0);\
+ }
+ #define SSC_ATOMIC_STORE64_IMPL(Ptr, V) {\
+  _InterlockedExchange64((volatile __int64*)(Ptr), (__int64)(V));\
+ }
+ #define SSC_ATOMIC_FETCHADD64_IMPL(Ptr, V) {\
+  return (uint64_t)_InterlockedExchangeAdd64((volatile __int64*)(Ptr), (__int64)(V));\
+ }
+ #define SSC_ATOMIC_CMPXCHG64_IMPL(Ptr, Expected, Desired) {\
+  const __int64 prev = _InterlockedCompareExchange64((volatile __int64*)(Ptr), (__int64)(Desired), (__int64)*(Expected));\
+  if (prev == (__int64)*(Expected))\
+    return true;\
+  *(Expected) = (uint64_t)prev;\
+  return false;\
+ }
+ #if defined(SSC_OS_WIN64)
+  #define SSC_ATOMIC_LOADSIZE_IMPL(Ptr)        SSC_ATOMIC_LOAD64_IMPL(Ptr)
+  #define SSC_ATOMIC_STORESIZE_IMPL(Ptr, V)    SSC_ATOMIC_STORE64_IMPL(Ptr, V)
+  #define SSC_ATOMIC_FETCHADDSIZE_IMPL(Ptr, V) SSC_ATOMIC_FETCHADD64_IMPL(Ptr, V)
+ #else
+  #define SSC_ATOMIC_LOADSIZE_IMPL(Ptr) {\
+   return (size_t)_InterlockedCompareExchange((volatile long*)(Ptr), 0, 0);\
+  }
+  #define SSC_ATOMIC_STORESIZE_IMPL(Ptr, V) {\
+   _InterlockedExchange((volatile long*)(Ptr), (long)(V));\
+  }
+  #define SSC_ATOMIC_FETCHADDSIZE_IMPL(Ptr, V) {\
+   return (size_t)_InterlockedExchangeAdd((volatile long*)(Ptr), (long)(V));\
+  }
+ #endif
+#else
+ #error "Unsupported compiler."
+#endif
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/* Atomically load the value of @ptr. */
+SSC_INLINE uint32_t
+SSC_atomicLoad32(const volatile uint32_t* ptr)
+SSC_ATOMIC_LOAD32_IMPL(ptr)
+
+/* Atomically store @val into @ptr. */
+SSC_INLINE void
+SSC_atomicStore32(volatile uint32_t* ptr, uint32_t val)
+SSC_ATOMIC_STORE32_IMPL(ptr, val)
+
+/* Atomically load the value of @ptr. */
+SSC_INLINE uint64_t
+SSC_atomicLoad64(const volatile uint64_t* ptr)
+SSC_ATOMIC_LOAD64_IMPL(ptr)
+
+/* Atomically store @val into @ptr. */
+SSC_INLINE void
+SSC_atomicStore64(volatile uint64_t* ptr, uint64_t val)
+SSC_ATOMIC_STORE64_IMPL(ptr, val)
+
+/* Atomically add @val to @ptr, returning the value @ptr held beforehand. */
+SSC_INLINE uint64_t
+SSC_atomicFetchAdd64(volatile uint64_t* ptr, uint64_t val)
+SSC_ATOMIC_FETCHADD64_IMPL(ptr, val)
+
+/* If @ptr holds *@expected, atomically replace it with @desired and return true.
+ * Otherwise store the value @ptr holds into @expected and return false. */
+SSC_INLINE bool
+SSC_atomicCompareExchange64(volatile uint64_t* R_ ptr, uint64_t* R_ expected, uint64_t desired)
+SSC_ATOMIC_CMPXCHG64_IMPL(ptr, expected, desired)
+
+/* Atomically load the value of @ptr. */
+SSC_INLINE size_t
+SSC_atomicLoadSize(const volatile size_t* ptr)
+SSC_ATOMIC_LOADSIZE_IMPL(ptr)
+
+/* Atomically store @val into @ptr. */
+SSC_INLINE void
+SSC_atomicStoreSize(volatile size_t* ptr, size_t val)
+SSC_ATOMIC_STORESIZE_IMPL(ptr, val)
+
+/* Atomically add @val to @ptr, returning the value @ptr held beforehand. */
+SSC_INLINE size_t
+SSC_atomicFetchAddSize(volatile size_t* ptr, size_t val)
+SSC_ATOMIC_FETCHADDSIZE_IMPL(ptr, val)
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_ATOMIC_H */
@@ -19,8 +19,11 @@
  #include <unistd.h>
  #include <sys/stat.h>
  #include <sys/types.h>
+ #include <sys/uio.h>
  /* On Unix-like systems, files are managed through integer handles, "file descriptors". */
  typedef int SSC_File_t;
+ /* Scatter/gather buffers are the system's own, so they may be passed to readv() etc. directly. */
+ typedef struct iovec SSC_IoVec;
  #define SSC_FILE_IS_INT
  #define SSC_FILE_CLOSE_IMPL_FUNCTION   close
  #define SSC_FILE_SETSIZE_IMPL_FUNCTION ftruncate
@@ -32,6 +35,11 @@
  #include <direct.h>
  /* On Windows systems, files are managed through HANDLEs. */
  typedef HANDLE SSC_File_t;
+ /* Scatter/gather buffers, with the same members as the POSIX struct iovec. */
+ typedef struct {
+   void*  iov_base;
+   size_t iov_len;
+ } SSC_IoVec;
  #define SSC_CHDIR_IMPL_FUNCTION _chdir
  #define SSC_FILE_CLOSE_IMPL(File) {\
   if (CloseHandle(File))\
@@ -140,6 +148,54 @@ SSC_FilePath_openOrDie(const char* R_ fpath, bool ronly)
 }
 /*==========================================================================================*/
 
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Open-Or-Create Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_FILEPATH_OPEN_READONLY  = 0x01, /* Open an existing file readonly. Created files are always readwrite. */
+  SSC_FILEPATH_OPEN_CREATE    = 0x02, /* Create the file when it doesn't exist. */
+  SSC_FILEPATH_OPEN_EXCLUSIVE = 0x04, /* Only create the file; fail when it already exists. */
+  /* Bypass the page cache, so that large one-shot scans don't evict hot data. Buffers, offsets
+   * and sizes must then be aligned; see SSC_File_getDirectAlignment(). This is O_DIRECT, or
+   * F_NOCACHE on macOS, or FILE_FLAG_NO_BUFFERING on Windows. Where the filesystem refuses
+   * direct I/O, the file is opened buffered instead. */
+  SSC_FILEPATH_OPEN_DIRECT    = 0x08,
+  /* Don't update the file's access time on reads (O_NOATIME). Only the file's owner may ask
+   * this of Linux; otherwise, or on systems without it, the flag has no effect. */
+  SSC_FILEPATH_OPEN_NOATIME   = 0x10,
+  /* Close the file in children that exec() (O_CLOEXEC). Windows handles aren't inherited anyway. */
+  SSC_FILEPATH_OPEN_CLOEXEC   = 0x20,
+  /* Return from writes only once the data and metadata reach storage (O_SYNC). */
+  SSC_FILEPATH_OPEN_SYNC      = 0x40,
+  /* Return from writes only once the data, and the metadata needed to read it back, reach
+   * storage (O_DSYNC). On Windows, this and SSC_FILEPATH_OPEN_SYNC are FILE_FLAG_WRITE_THROUGH. */
+  SSC_FILEPATH_OPEN_DSYNC     = 0x80,
+};
+/*==========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Open-Or-Create Error Codes
+ *     SSC_CodeError_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_FILEPATH_OPEN_CODE_OK          =  0,
+  SSC_FILEPATH_OPEN_CODE_ERR_NOEXIST = -1, /* There is no file, and we weren't allowed to create one. */
+  SSC_FILEPATH_OPEN_CODE_ERR_EXIST   = -2, /* There is a file, and we were only allowed to create one. */
+  SSC_FILEPATH_OPEN_CODE_ERR_OPEN    = -3, /* The existing file could not be opened. */
+  SSC_FILEPATH_OPEN_CODE_ERR_CREATE  = -4, /* The new file could not be created. */
+};
+/*==========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Open the file at @fpath, or create it there, according to the open-or-create flags @flags.
+ * Existence is decided by the open itself, so there is no window between checking for a
+ * file and opening it. When @created is not SSC_NULL, store whether a new file was created. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_FilePath_openOrCreate(const char* R_ fpath, SSC_BitFlag_t flags, SSC_File_t* R_ file, bool* R_ created);
+/*==========================================================================================*/
+
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 /* Create a file at a specified filepath. */
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
@@ -200,6 +256,107 @@ SSC_File_setSizeOrDie(SSC_File_t file, size_t size)
 }
 /*==========================================================================================*/
 
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Positional I/O
+ *   Read or write at an explicit file offset, so that many threads may share one file at once.
+ *   Transfers are retried until complete; short transfers and interrupted system calls are
+ *   handled internally. On Unixlikes the file's position is not moved. On Windows it is left
+ *   just past the last transfer, as ReadFile() and WriteFile() with an OVERLAPPED offset move
+ *   the position of synchronous handles; don't mix these with position-relative I/O there. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Read @size bytes of @file at @offset into @buf.
+ * When @readcount is not SSC_NULL, store the number of bytes read there; it is less than @size
+ * only when the end of the file was reached. When @readcount is SSC_NULL, reaching the end of
+ * the file before @size bytes were read is an error. */
+SSC_API SSC_Error_t
+SSC_File_readAt(SSC_File_t file, void* R_ buf, size_t size, size_t offset, size_t* R_ readcount);
+
+SSC_INLINE void
+SSC_File_readAtOrDie(SSC_File_t file, void* R_ buf, size_t size, size_t offset)
+{
+  SSC_assertMsg(
+   !SSC_File_readAt(file, buf, size, offset, SSC_NULL),
+   "Error: SSC_File_readAt() failed to read %zu bytes at offset %zu!\n", size, offset);
+}
+
+/* Write the @size bytes at @buf to @file at @offset, extending the file if necessary. */
+SSC_API SSC_Error_t
+SSC_File_writeAt(SSC_File_t file, const void* R_ buf, size_t size, size_t offset);
+
+SSC_INLINE void
+SSC_File_writeAtOrDie(SSC_File_t file, const void* R_ buf, size_t size, size_t offset)
+{
+  SSC_assertMsg(
+   !SSC_File_writeAt(file, buf, size, offset),
+   "Error: SSC_File_writeAt() failed to write %zu bytes at offset %zu!\n", size, offset);
+}
+/*==========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Vectored I/O
+ *   Read into, or write from, the @count buffers described by @iov in order, as one transfer,
+ *   so that data assembled from several buffers needn't be copied together first.
+ *   Any number of buffers may be given; they are passed to the system IOV_MAX at a time, and
+ *   transfers are retried until complete, as with SSC_File_readAt() and SSC_File_writeAt().
+ *   The *At forms transfer at @offset, moving the file's position only on Windows, as with
+ *   SSC_File_readAt(); the others transfer at, and advance, the file's position. On Windows,
+ *   where ordinary handles have no vectored I/O, the buffers are transferred one after another. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* @readcount has the same meaning as it does to SSC_File_readAt(). */
+SSC_API SSC_Error_t
+SSC_File_readv(SSC_File_t file, const SSC_IoVec* R_ iov, size_t count, size_t* R_ readcount);
+
+SSC_API SSC_Error_t
+SSC_File_writev(SSC_File_t file, const SSC_IoVec* iov, size_t count);
+
+SSC_API SSC_Error_t
+SSC_File_readvAt(SSC_File_t file, const SSC_IoVec* R_ iov, size_t count, size_t offset, size_t* R_ readcount);
+
+SSC_API SSC_Error_t
+SSC_File_writevAt(SSC_File_t file, const SSC_IoVec* iov, size_t count, size_t offset);
+/*==========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Direct I/O
+ *   Files opened with SSC_FILEPATH_OPEN_DIRECT transfer straight between storage and the
+ *   caller's buffers, which must start at an aligned address, and move aligned sizes at
+ *   aligned offsets. Only a read reaching the end of the file may return less. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Store in @alignment the alignment direct I/O on @file needs: the logical block size of the
+ * device beneath it, or what the filesystem reports, where the OS says. When the device can't be
+ * determined, the page size is assumed, which suffices for every common device. */
+SSC_API SSC_Error_t
+SSC_File_getDirectAlignment(SSC_File_t file, size_t* R_ alignment);
+
+/* Round @n down to a multiple of the power of 2 @alignment. */
+SSC_INLINE size_t
+SSC_File_alignDown(size_t n, size_t alignment)
+{
+  return n & ~(alignment - 1);
+}
+
+/* Round @n up to a multiple of the power of 2 @alignment. */
+SSC_INLINE size_t
+SSC_File_alignUp(size_t n, size_t alignment)
+{
+  return (n + (alignment - 1)) & ~(alignment - 1);
+}
+
+/* Return a buffer for direct I/O on @file, of *@size bytes rounded up to the file's alignment,
+ * storing the rounded size in @size. Free it with SSC_alignedFree(). */
+SSC_API void*
+SSC_File_directMalloc(SSC_File_t file, size_t* size);
+/* On failure, return SSC_NULL. */
+
+SSC_INLINE void*
+SSC_File_directMallocOrDie(SSC_File_t file, size_t* size)
+{
+  void* p = SSC_File_directMalloc(file, size);
+  SSC_assertMsg(p != SSC_NULL, "Error: SSC_File_directMallocOrDie died!\n");
+  return p;
+}
+/*==========================================================================================*/
+
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 /* Change the current working directory to @path. */
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
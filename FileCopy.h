@@ -0,0 +1,93 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define copying between files without passing the data through a buffer
+ * of our own. The fastest method the system and filesystems allow is chosen:
+ *
+ *   1. Cloning (FICLONE): the copy shares the source's blocks until either is written.
+ *      Only whole files are cloned, on filesystems with reflinks (e.g. XFS, btrfs).
+ *   2. copy_file_range(): the kernel copies, and itself clones or offloads where it can.
+ *   3. splice() through a pipe: the source's pages are passed by reference, and copied once.
+ *   4. A chunked memory-mapped copy: the source is mapped a chunk at a time, and each chunk
+ *      written to the destination directly, so that each byte is copied once.
+ *
+ * The first three are Linux only; elsewhere, every copy is a mapped copy, except that macOS
+ * clones whole files by path with clonefile(), and Windows copies them with CopyFileA().
+ * A copy begins with the fastest method, and continues with the next from wherever a method
+ * the files don't support left off. */
+#ifndef SSC_FILECOPY_H
+#define SSC_FILECOPY_H
+
+#include <stdbool.h>
+
+#include "Error.h"
+#include "File.h"
+#include "Macro.h"
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Copy Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  /* Give the copy blocks of its own, rather than sharing the source's. Skips cloning and
+   * copy_file_range(), which may clone. */
+  SSC_FILECOPY_NOCLONE = 0x01,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Copy @size bytes of @src at @src_offset into @dst at @dst_offset, extending @dst as
+ * necessary. Neither file's position is used or moved. The ranges must not overlap.
+ * When @copied is not SSC_NULL, store the number of bytes copied there; it is less than @size
+ * only when the end of @src was reached. When @copied is SSC_NULL, reaching the end of @src
+ * before @size bytes were copied is an error. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_FileCopy_range(
+ SSC_File_t    dst,
+ size_t        dst_offset,
+ SSC_File_t    src,
+ size_t        src_offset,
+ size_t        size,
+ SSC_BitFlag_t flags,
+ size_t* R_    copied);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Make @dst a copy of the whole of @src, replacing its contents, cloning it when possible. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_FileCopy_file(SSC_File_t dst, SSC_File_t src, SSC_BitFlag_t flags);
+
+/* Copy the file at @src_path to @dst_path, replacing any file there. When the copy fails,
+ * any file it created at @dst_path is removed. */
+SSC_API SSC_Error_t
+SSC_FileCopy_path(const char* R_ dst_path, const char* R_ src_path, SSC_BitFlag_t flags);
+
+SSC_INLINE void
+SSC_FileCopy_pathOrDie(const char* R_ dst_path, const char* R_ src_path, SSC_BitFlag_t flags)
+{
+  SSC_assertMsg(
+   !SSC_FileCopy_path(dst_path, src_path, flags),
+   "Error: SSC_FileCopy_path() failed to copy %s to %s!\n", src_path, dst_path);
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Write @size bytes of @src at @src_offset to @out at its position, where @out may be a pipe
+ * or a socket, as well as a file. On Linux the kernel sends the data with sendfile(); elsewhere
+ * it is written from a mapping of @src. @out should block, so that every write completes.
+ * When @sent is not SSC_NULL, store the number of bytes sent there; it is less than @size only
+ * when the end of @src was reached. When @sent is SSC_NULL, that is an error. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_FileCopy_send(SSC_File_t out, SSC_File_t src, size_t src_offset, size_t size, size_t* R_ sent);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_FILECOPY_H */
@@ -0,0 +1,176 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define a readonly key->value hash index stored in a file, which is queried
+ * directly through a memory-map: opening an index reads nothing but its header, no matter how
+ * many entries it holds. Keys are byte strings; values are 64-bit unsigned integers (e.g.
+ * offsets into another file). Indexes are written once, by a SSC_HashIndexBuilder.
+ *
+ *   Offset | Size | Field
+ *   -------+------+------------------------------------------------------------
+ *        0 |    8 | Magic bytes, "SSCHSIDX".
+ *        8 |    4 | Format version. (SSC_HASHINDEX_VERSION)
+ *       12 |    4 | Reserved; zero.
+ *       16 |    8 | Bucket count; a power of 2.
+ *       24 |    8 | Entry count.
+ *       32 |    8 | Record heap size, in bytes.
+ *       40 |   24 | Reserved; zero.
+ *       64 |  ... | Buckets, 64 bytes each.
+ *      ... |  ... | Record heap.
+ *
+ * Each bucket fills one cache line, and holds 4 slots of 16 bytes:
+ *
+ *   Offset | Size | Field
+ *   -------+------+------------------------------------------------------------
+ *        0 |    4 | Tag: the high 32 bits of the key's hash, or 1 if those are 0. 0 when empty.
+ *        4 |    4 | Key size, in bytes.
+ *        8 |    8 | Offset of the entry's record in the record heap.
+ *
+ * A record is the 8 byte value, followed by the key. Every field is little endian.
+ * Keys are hashed with 64-bit FNV-1a. An entry lives in the first free slot at or after
+ * bucket (hash % bucket count), so a lookup compares tags across one cache line, and touches
+ * the record heap only on a tag match. */
+#ifndef SSC_HASHINDEX_H
+#define SSC_HASHINDEX_H
+
+#include <stdbool.h>
+
+#include "Error.h"
+#include "Macro.h"
+#include "MemMap.h"
+#include "Memory.h"
+
+#define SSC_HASHINDEX_HEADER_SIZE 64 /* Buckets begin at this file offset. */
+#define SSC_HASHINDEX_BUCKET_SIZE 64
+#define SSC_HASHINDEX_VERSION     1
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Hash Index */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  SSC_MemMap     map;       /* The mapped file; the header is at @map.ptr. */
+  const uint8_t* buckets;   /* The first bucket. */
+  const uint8_t* heap;      /* The record heap. */
+  size_t         heap_size; /* The size of the record heap, in bytes. */
+  uint64_t       mask;      /* The bucket count, minus 1. */
+  size_t         count;     /* The number of entries. */
+} SSC_HashIndex;
+#define SSC_HASHINDEX_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_HashIndex, SSC_MEMMAP_NULL_LITERAL, SSC_NULL, SSC_NULL, 0, 0, 0)
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  /* Fault in the whole index up front, trading a slower open for no page faults on lookups.
+   * See SSC_MEMMAP_INIT_PREFAULT. */
+  SSC_HASHINDEX_INIT_PREFAULT = 0x01,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Error Codes
+ *     SSC_CodeError_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_HASHINDEX_INIT_CODE_OK          =  0,
+  SSC_HASHINDEX_INIT_CODE_ERR_MAP     = -1, /* Failed to open or map the file. */
+  SSC_HASHINDEX_INIT_CODE_ERR_MAGIC   = -2, /* The file is not a hash index. */
+  SSC_HASHINDEX_INIT_CODE_ERR_VERSION = -3, /* The file's format version is unsupported. */
+  SSC_HASHINDEX_INIT_CODE_ERR_CORRUPT = -4, /* The file is too small for its header's geometry. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Map the index at @filepath readonly. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_HashIndex_init(SSC_HashIndex* R_ idx, const char* R_ filepath, SSC_BitFlag_t flags);
+
+SSC_API void
+SSC_HashIndex_initOrDie(SSC_HashIndex* R_ idx, const char* R_ filepath, SSC_BitFlag_t flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Look up entries. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Return the number of entries in @idx. */
+SSC_INLINE size_t
+SSC_HashIndex_count(const SSC_HashIndex* idx)
+{
+  return idx->count;
+}
+
+/* Hash the @key_size bytes at @key as indexes do. */
+SSC_API uint64_t
+SSC_HashIndex_hash(const void* key, size_t key_size);
+
+/* Find the @key_size byte key at @key in @idx. If it is present, store its value in @value
+ * and return true; otherwise return false. A key added more than once finds its first value. */
+SSC_API bool
+SSC_HashIndex_find(const SSC_HashIndex* R_ idx, const void* R_ key, size_t key_size, uint64_t* R_ value);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Unmap and close the index. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void
+SSC_HashIndex_del(SSC_HashIndex* idx);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Hash Index Builder
+ *   Entries are collected in memory, then laid out and written to a file all at once.
+ *   The builder keeps the buckets at most 3/4 full. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  uint64_t hash;     /* The hash of the key. */
+  uint64_t record;   /* The offset of the entry's record in the record heap. */
+  uint32_t key_size; /* The size of the key, in bytes. */
+} SSC_HashIndexBuilderEntry;
+
+typedef struct {
+  SSC_HashIndexBuilderEntry* entries;
+  size_t                     count;
+  size_t                     capacity;
+  uint8_t*                   heap;
+  size_t                     heap_size;
+  size_t                     heap_capacity;
+} SSC_HashIndexBuilder;
+#define SSC_HASHINDEXBUILDER_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_HashIndexBuilder, SSC_NULL, 0, 0, SSC_NULL, 0, 0)
+
+/* Add the @key_size byte key at @key to @builder, with @value. */
+SSC_API SSC_Error_t
+SSC_HashIndexBuilder_add(SSC_HashIndexBuilder* R_ builder, const void* R_ key, size_t key_size, uint64_t value);
+
+SSC_INLINE void
+SSC_HashIndexBuilder_addOrDie(SSC_HashIndexBuilder* R_ builder, const void* R_ key, size_t key_size, uint64_t value)
+{
+  SSC_assertMsg(!SSC_HashIndexBuilder_add(builder, key, key_size, value), "Error: SSC_HashIndexBuilder_add() failed!\n");
+}
+
+/* Write an index of the entries of @builder to @filepath, replacing any file there.
+ * To replace an index that readers may have mapped, write to a new path and rename it over
+ * the old one, rather than rewriting the old file in place. */
+SSC_API SSC_Error_t
+SSC_HashIndexBuilder_write(const SSC_HashIndexBuilder* R_ builder, const char* R_ filepath);
+
+SSC_INLINE void
+SSC_HashIndexBuilder_writeOrDie(const SSC_HashIndexBuilder* R_ builder, const char* R_ filepath)
+{
+  SSC_assertMsg(!SSC_HashIndexBuilder_write(builder, filepath), "Error: SSC_HashIndexBuilder_write() failed to write %s!\n", filepath);
+}
+
+/* Free the memory of @builder. */
+SSC_API void
+SSC_HashIndexBuilder_del(SSC_HashIndexBuilder* builder);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_HASHINDEX_H */
@@ -0,0 +1,643 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "AsyncIo.h"
+#include "Atomic.h"
+#include "Thread.h"
+#define R_ SSC_RESTRICT
+
+#if   defined(SSC_OS_UNIXLIKE)
+ #include <errno.h>
+ #include <pthread.h>
+ #if defined(__gnu_linux__)
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #if defined(SYS_io_uring_setup) && defined(SYS_io_uring_enter) && defined(SYS_io_uring_register)
+   #include <linux/io_uring.h>
+   #define HAS_URING_
+  #endif
+ #endif
+typedef pthread_mutex_t Mutex_;
+typedef pthread_cond_t  Cond_;
+ #define LOCK_(Mutex)       pthread_mutex_lock(Mutex)
+ #define UNLOCK_(Mutex)     pthread_mutex_unlock(Mutex)
+ #define WAIT_(Cond, Mutex) pthread_cond_wait(Cond, Mutex)
+ #define SIGNAL_(Cond)      pthread_cond_signal(Cond)
+ #define BROADCAST_(Cond)   pthread_cond_broadcast(Cond)
+#elif defined(SSC_OS_WINDOWS)
+typedef SRWLOCK            Mutex_;
+typedef CONDITION_VARIABLE Cond_;
+ #define LOCK_(Mutex)       AcquireSRWLockExclusive(Mutex)
+ #define UNLOCK_(Mutex)     ReleaseSRWLockExclusive(Mutex)
+ #define WAIT_(Cond, Mutex) SleepConditionVariableSRW(Cond, Mutex, INFINITE, 0)
+ #define SIGNAL_(Cond)      WakeConditionVariable(Cond)
+ #define BROADCAST_(Cond)   WakeAllConditionVariable(Cond)
+#else
+ #error "Unsupported operating system."
+#endif
+
+#define OK_          SSC_ASYNCIO_INIT_CODE_OK
+#define ERR_DEPTH_   SSC_ASYNCIO_INIT_CODE_ERR_DEPTH
+#define ERR_ALLOC_   SSC_ASYNCIO_INIT_CODE_ERR_ALLOC
+#define ERR_THREADS_ SSC_ASYNCIO_INIT_CODE_ERR_THREADS
+
+#define DRAIN_BATCH_ 64
+
+typedef struct {
+  SSC_AsyncIoRequest req;    /* A copy of the request, naming its file directly. */
+  SSC_IoVec          iov;    /* io_uring reads and writes unregistered buffers through this. */
+  int64_t            result; /* The thread pool's result. */
+} Slot_;
+
+/* The thread pool hands slots to threads through @queue, and back through @finished. Both are
+ * rings of slot indices, of the engine's depth. */
+typedef struct {
+  Mutex_        lock;
+  Cond_         work; /* Signaled when slots are queued, or the pool stops. */
+  Cond_         done; /* Signaled when a slot is finished. */
+  unsigned*     queue;
+  unsigned      queue_head;
+  unsigned      queue_count;
+  unsigned*     finished;
+  unsigned      finished_head;
+  unsigned      finished_count;
+  SSC_Thread_t* threads;
+  unsigned      thread_count;
+  bool          stop;
+  bool          sync_ok; /* @lock, @work and @done were initialized. */
+} Pool_;
+
+#ifdef HAS_URING_
+typedef struct {
+  int                  fd;
+  uint8_t*             sq_ring;
+  size_t               sq_ring_size;
+  uint8_t*             cq_ring;      /* May be @sq_ring, when @cq_ring_size is 0. */
+  size_t               cq_ring_size;
+  struct io_uring_sqe* sqes;
+  size_t               sqes_size;
+  volatile uint32_t*   sq_head;
+  volatile uint32_t*   sq_tail;
+  uint32_t*            sq_array;
+  uint32_t             sq_mask;
+  volatile uint32_t*   cq_head;
+  volatile uint32_t*   cq_tail;
+  struct io_uring_cqe* cqes;
+  uint32_t             cq_mask;
+} Uring_;
+#endif
+
+typedef struct {
+  Slot_*      slots;
+  unsigned*   free;       /* A stack of the indices of free slots. */
+  unsigned    free_count;
+  unsigned*   pending;    /* The indices of prepared slots, in order of preparation. */
+  SSC_File_t* files;      /* The registered files. */
+  unsigned    file_count;
+  SSC_IoVec*  bufs;       /* The registered buffers. */
+  unsigned    buf_count;
+  unsigned    depth;
+  Pool_       pool;
+#ifdef HAS_URING_
+  Uring_      uring;
+#endif
+} Engine_;
+
+/* Return the negative result of a request that failed just now. */
+static int64_t
+failure_(void)
+{
+#if   defined(SSC_OS_UNIXLIKE)
+  return errno ? -(int64_t)errno : -1;
+#elif defined(SSC_OS_WINDOWS)
+  const DWORD err = GetLastError();
+  return err ? -(int64_t)err : -1;
+#endif
+}
+
+/* Perform @req synchronously, returning its result. */
+static int64_t
+perform_(const SSC_AsyncIoRequest* req)
+{
+  size_t n = req->size;
+  SSC_Error_t err;
+#if defined(SSC_OS_UNIXLIKE)
+  errno = 0;
+#endif
+  switch (req->op) {
+    case SSC_ASYNCIO_OP_READ:
+      err = SSC_File_readAt(req->file, req->buf, req->size, req->offset, &n);
+      break;
+    case SSC_ASYNCIO_OP_WRITE:
+      err = SSC_File_writeAt(req->file, req->buf, req->size, req->offset);
+      break;
+    default:
+      n = 0;
+#if   defined(SSC_OS_UNIXLIKE)
+      err = fsync(req->file) ? -1 : 0;
+#elif defined(SSC_OS_WINDOWS)
+      err = FlushFileBuffers(req->file) ? 0 : -1;
+#endif
+      break;
+  }
+  return err ? failure_() : (int64_t)n;
+}
+
+/* Run queued slots until the pool stops. */
+static void
+work_(void* arg)
+{
+  Engine_* e = (Engine_*)arg;
+  Pool_*   p = &e->pool;
+  LOCK_(&p->lock);
+  for (;;) {
+    unsigned i;
+    while (!p->queue_count && !p->stop)
+      WAIT_(&p->work, &p->lock);
+    if (p->stop)
+      break;
+    i = p->queue[p->queue_head];
+    p->queue_head = (p->queue_head + 1) % e->depth;
+    --p->queue_count;
+    UNLOCK_(&p->lock);
+    e->slots[i].result = perform_(&e->slots[i].req);
+    LOCK_(&p->lock);
+    p->finished[(p->finished_head + p->finished_count) % e->depth] = i;
+    ++p->finished_count;
+    SIGNAL_(&p->done);
+  }
+  UNLOCK_(&p->lock);
+}
+
+/* Stop and join the threads of the pool, and free it. */
+static void
+poolDel_(Pool_* p)
+{
+  if (p->sync_ok) {
+    LOCK_(&p->lock);
+    p->stop = true;
+    BROADCAST_(&p->work);
+    UNLOCK_(&p->lock);
+    for (unsigned i = 0; i < p->thread_count; ++i)
+      SSC_Thread_join(p->threads[i]);
+#if defined(SSC_OS_UNIXLIKE)
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->work);
+    pthread_mutex_destroy(&p->lock);
+#endif
+  }
+  free(p->threads);
+  free(p->finished);
+  free(p->queue);
+}
+
+static SSC_CodeError_t
+poolInit_(Engine_* e, unsigned threads)
+{
+  Pool_* p = &e->pool;
+  if (!threads)
+    threads = SSC_getProcessorCount();
+  if (threads > e->depth)
+    threads = e->depth;
+  p->queue    = (unsigned*)malloc(e->depth * sizeof(unsigned));
+  p->finished = (unsigned*)malloc(e->depth * sizeof(unsigned));
+  p->threads  = (SSC_Thread_t*)malloc(threads * sizeof(SSC_Thread_t));
+  if (!p->queue || !p->finished || !p->threads)
+    return ERR_ALLOC_;
+#if   defined(SSC_OS_UNIXLIKE)
+  if (pthread_mutex_init(&p->lock, SSC_NULL))
+    return ERR_THREADS_;
+  if (pthread_cond_init(&p->work, SSC_NULL)) {
+    pthread_mutex_destroy(&p->lock);
+    return ERR_THREADS_;
+  }
+  if (pthread_cond_init(&p->done, SSC_NULL)) {
+    pthread_cond_destroy(&p->work);
+    pthread_mutex_destroy(&p->lock);
+    return ERR_THREADS_;
+  }
+#elif defined(SSC_OS_WINDOWS)
+  InitializeSRWLock(&p->lock);
+  InitializeConditionVariable(&p->work);
+  InitializeConditionVariable(&p->done);
+#endif
+  p->sync_ok = true;
+  for (; p->thread_count < threads; ++p->thread_count) {
+    if (SSC_Thread_create(p->threads + p->thread_count, work_, e))
+      return ERR_THREADS_;
+  }
+  return OK_;
+}
+
+static void
+poolSubmit_(Engine_* e, unsigned count)
+{
+  Pool_* p = &e->pool;
+  LOCK_(&p->lock);
+  for (unsigned k = 0; k < count; ++k) {
+    p->queue[(p->queue_head + p->queue_count) % e->depth] = e->pending[k];
+    ++p->queue_count;
+  }
+  BROADCAST_(&p->work);
+  UNLOCK_(&p->lock);
+}
+
+static unsigned
+poolReap_(Engine_* R_ e, SSC_AsyncIoCompletion* R_ completions, unsigned max, unsigned min)
+{
+  Pool_*   p = &e->pool;
+  unsigned got = 0;
+  LOCK_(&p->lock);
+  while (p->finished_count < min)
+    WAIT_(&p->done, &p->lock);
+  while (got < max && p->finished_count) {
+    const unsigned i = p->finished[p->finished_head];
+    p->finished_head = (p->finished_head + 1) % e->depth;
+    --p->finished_count;
+    completions[got].user   = e->slots[i].req.user;
+    completions[got].result = e->slots[i].result;
+    e->free[e->free_count++] = i;
+    ++got;
+  }
+  UNLOCK_(&p->lock);
+  return got;
+}
+
+#ifdef HAS_URING_
+static void
+uringDel_(Uring_* u)
+{
+  if (u->sqes)
+    munmap(u->sqes, u->sqes_size);
+  if (u->cq_ring && u->cq_ring_size)
+    munmap(u->cq_ring, u->cq_ring_size);
+  if (u->sq_ring)
+    munmap(u->sq_ring, u->sq_ring_size);
+  if (u->fd >= 0)
+    close(u->fd);
+}
+
+/* Map the rings shared with the kernel. */
+static void*
+uringMap_(int fd, size_t size, off_t offset)
+{
+  void* p = mmap(SSC_NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, offset);
+  return (p == MAP_FAILED) ? SSC_NULL : p;
+}
+
+static SSC_Error_t
+uringInit_(Uring_* u, unsigned depth)
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  u->fd = (int)syscall(SYS_io_uring_setup, depth, &params);
+  if (u->fd < 0)
+    return -1;
+  u->sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+  u->cq_ring_size = params.cq_off.cqes  + (params.cq_entries * sizeof(struct io_uring_cqe));
+  u->sqes_size    = params.sq_entries * sizeof(struct io_uring_sqe);
+ #ifdef IORING_FEAT_SINGLE_MMAP
+  /* Since Linux 5.4, both rings share one mapping. */
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (u->cq_ring_size > u->sq_ring_size)
+      u->sq_ring_size = u->cq_ring_size;
+    u->cq_ring_size = 0;
+  }
+ #endif
+  u->sq_ring = (uint8_t*)uringMap_(u->fd, u->sq_ring_size, IORING_OFF_SQ_RING);
+  if (!u->sq_ring)
+    return -1;
+  if (u->cq_ring_size) {
+    u->cq_ring = (uint8_t*)uringMap_(u->fd, u->cq_ring_size, IORING_OFF_CQ_RING);
+    if (!u->cq_ring)
+      return -1;
+  } else
+    u->cq_ring = u->sq_ring;
+  u->sqes = (struct io_uring_sqe*)uringMap_(u->fd, u->sqes_size, IORING_OFF_SQES);
+  if (!u->sqes)
+    return -1;
+  u->sq_head  = (volatile uint32_t*)(u->sq_ring + params.sq_off.head);
+  u->sq_tail  = (volatile uint32_t*)(u->sq_ring + params.sq_off.tail);
+  u->sq_array = (uint32_t*)(u->sq_ring + params.sq_off.array);
+  u->sq_mask  = *(uint32_t*)(u->sq_ring + params.sq_off.ring_mask);
+  u->cq_head  = (volatile uint32_t*)(u->cq_ring + params.cq_off.head);
+  u->cq_tail  = (volatile uint32_t*)(u->cq_ring + params.cq_off.tail);
+  u->cqes     = (struct io_uring_cqe*)(u->cq_ring + params.cq_off.cqes);
+  u->cq_mask  = *(uint32_t*)(u->cq_ring + params.cq_off.ring_mask);
+  return 0;
+}
+
+/* Hand the kernel every entry of the submission queue it hasn't yet consumed, and wait for
+ * @min completions. The kernel may consume fewer entries than it is offered; the rest go with
+ * the next call. */
+static SSC_Error_t
+uringEnter_(Uring_* u, unsigned min)
+{
+  for (;;) {
+    const uint32_t n = *u->sq_tail - SSC_atomicLoad32(u->sq_head);
+    if (!n && !min)
+      return 0;
+    if (syscall(SYS_io_uring_enter, u->fd, n, min, min ? IORING_ENTER_GETEVENTS : 0u, SSC_NULL, 0) >= 0)
+      return 0;
+    if (errno == EINTR)
+      continue;
+    /* The kernel is short of memory for now; whatever it didn't consume stays queued. */
+    return (errno == EAGAIN && !min) ? 0 : -1;
+  }
+}
+
+static SSC_Error_t
+uringSubmit_(Engine_* e, unsigned count)
+{
+  Uring_*  u = &e->uring;
+  uint32_t tail = *u->sq_tail;
+  for (unsigned k = 0; k < count; ++k, ++tail) {
+    const unsigned            i    = e->pending[k];
+    Slot_*                    s    = e->slots + i;
+    const uint32_t            idx  = tail & u->sq_mask;
+    struct io_uring_sqe*      sqe  = u->sqes + idx;
+    const SSC_AsyncIoRequest* req  = &s->req;
+    const bool                read = (req->op == SSC_ASYNCIO_OP_READ);
+    memset(sqe, 0, sizeof(*sqe));
+    if (req->flags & SSC_ASYNCIO_REQ_FIXED_FILE) {
+      sqe->flags |= IOSQE_FIXED_FILE;
+      sqe->fd = (int)req->file_index;
+    } else
+      sqe->fd = req->file;
+    sqe->user_data = (uint64_t)i;
+    /* An fsync with a nonzero offset or length would be read as a range to sync; leave them 0. */
+    if (req->op == SSC_ASYNCIO_OP_FSYNC)
+      sqe->opcode = IORING_OP_FSYNC;
+    else if (req->flags & SSC_ASYNCIO_REQ_FIXED_BUFFER) {
+      sqe->opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+      sqe->off = (uint64_t)req->offset;
+      sqe->addr = (uint64_t)(uintptr_t)req->buf;
+      sqe->len = (uint32_t)req->size;
+      sqe->buf_index = (uint16_t)req->buf_index;
+    } else {
+      /* IORING_OP_READV and IORING_OP_WRITEV date from Linux 5.1, unlike plain reads and writes. */
+      sqe->opcode = read ? IORING_OP_READV : IORING_OP_WRITEV;
+      sqe->off = (uint64_t)req->offset;
+      s->iov.iov_base = req->buf;
+      s->iov.iov_len = req->size;
+      sqe->addr = (uint64_t)(uintptr_t)&s->iov;
+      sqe->len = 1;
+    }
+    u->sq_array[idx] = idx;
+  }
+  SSC_atomicStore32(u->sq_tail, tail);
+  return uringEnter_(u, 0);
+}
+
+static SSC_Error_t
+uringReap_(Engine_* R_ e, SSC_AsyncIoCompletion* R_ completions, unsigned max, unsigned min, unsigned* R_ count)
+{
+  Uring_*  u = &e->uring;
+  unsigned got = 0;
+  SSC_Error_t err = uringEnter_(u, 0);
+  while (!err) {
+    const uint32_t tail = SSC_atomicLoad32(u->cq_tail);
+    uint32_t       head = *u->cq_head;
+    for (; got < max && head != tail; ++head, ++got) {
+      const struct io_uring_cqe* cqe = u->cqes + (head & u->cq_mask);
+      const unsigned i = (unsigned)cqe->user_data;
+      completions[got].user   = e->slots[i].req.user;
+      completions[got].result = (int64_t)cqe->res;
+      e->free[e->free_count++] = i;
+    }
+    SSC_atomicStore32(u->cq_head, head);
+    if (got >= min)
+      break;
+    err = uringEnter_(u, min - got);
+  }
+  *count = got;
+  return err;
+}
+#endif /* ~ HAS_URING_ */
+
+SSC_CodeError_t SSC_AsyncIo_init(SSC_AsyncIo* aio, unsigned depth, unsigned threads, SSC_BitFlag_t flags)
+{
+  Engine_* e;
+  SSC_CodeError_t ce;
+
+  *aio = SSC_ASYNCIO_NULL_LITERAL;
+  if (depth == 0 || depth > SSC_ASYNCIO_MAX_DEPTH)
+    return ERR_DEPTH_;
+  e = (Engine_*)calloc(1, sizeof(Engine_));
+  if (!e)
+    return ERR_ALLOC_;
+  aio->engine = e;
+  aio->depth = depth;
+  e->depth = depth;
+#ifdef HAS_URING_
+  e->uring.fd = -1;
+#endif
+  e->slots   = (Slot_*)malloc(depth * sizeof(Slot_));
+  e->free    = (unsigned*)malloc(depth * sizeof(unsigned));
+  e->pending = (unsigned*)malloc(depth * sizeof(unsigned));
+  if (!e->slots || !e->free || !e->pending) {
+    SSC_AsyncIo_del(aio);
+    return ERR_ALLOC_;
+  }
+  for (unsigned i = 0; i < depth; ++i)
+    e->free[i] = depth - 1 - i;
+  e->free_count = depth;
+#ifdef HAS_URING_
+  if (!(flags & SSC_ASYNCIO_INIT_THREADS)) {
+    if (!uringInit_(&e->uring, depth)) {
+      aio->backend = SSC_ASYNCIO_BACKEND_URING;
+      return OK_;
+    }
+    /* io_uring is missing or forbidden; fall back to the thread pool. */
+    uringDel_(&e->uring);
+    memset(&e->uring, 0, sizeof(e->uring));
+    e->uring.fd = -1;
+  }
+#else
+  (void)flags;
+#endif
+  aio->backend = SSC_ASYNCIO_BACKEND_THREADS;
+  ce = poolInit_(e, threads);
+  if (ce) {
+    SSC_AsyncIo_del(aio);
+    return ce;
+  }
+  return OK_;
+}
+
+void SSC_AsyncIo_initOrDie(SSC_AsyncIo* aio, unsigned depth, unsigned threads, SSC_BitFlag_t flags)
+{
+  const char* err_str;
+  switch (SSC_AsyncIo_init(aio, depth, threads, flags)) {
+    case OK_:
+      return;
+    case ERR_DEPTH_:
+      err_str = "Invalid depth";
+      break;
+    case ERR_ALLOC_:
+      err_str = "Failed to allocate memory";
+      break;
+    case ERR_THREADS_:
+      err_str = "Failed to start the thread pool";
+      break;
+    default:
+      err_str = "Invalid SSC_CodeError_t";
+      break;
+  }
+  SSC_errx("Error: %s in SSC_AsyncIo_initOrDie() with depth %u!\n", err_str, depth);
+}
+
+SSC_Error_t SSC_AsyncIo_registerFiles(SSC_AsyncIo* R_ aio, const SSC_File_t* R_ files, unsigned count)
+{
+  Engine_*    e = (Engine_*)aio->engine;
+  SSC_File_t* copy = SSC_NULL;
+  SSC_Error_t err = 0;
+  if (aio->pending || aio->inflight)
+    return -1;
+  if (count) {
+    copy = (SSC_File_t*)malloc(count * sizeof(SSC_File_t));
+    if (!copy)
+      return -1;
+    memcpy(copy, files, count * sizeof(SSC_File_t));
+  }
+#ifdef HAS_URING_
+  if (aio->backend == SSC_ASYNCIO_BACKEND_URING) {
+    if (e->file_count)
+      syscall(SYS_io_uring_register, e->uring.fd, IORING_UNREGISTER_FILES, SSC_NULL, 0);
+    if (count && syscall(SYS_io_uring_register, e->uring.fd, IORING_REGISTER_FILES, copy, count)) {
+      free(copy);
+      copy = SSC_NULL;
+      count = 0;
+      err = -1;
+    }
+  }
+#endif
+  free(e->files);
+  e->files = copy;
+  e->file_count = count;
+  return err;
+}
+
+SSC_Error_t SSC_AsyncIo_registerBuffers(SSC_AsyncIo* R_ aio, const SSC_IoVec* R_ bufs, unsigned count)
+{
+  Engine_*   e = (Engine_*)aio->engine;
+  SSC_IoVec* copy = SSC_NULL;
+  SSC_Error_t err = 0;
+  if (aio->pending || aio->inflight)
+    return -1;
+  if (count) {
+    copy = (SSC_IoVec*)malloc(count * sizeof(SSC_IoVec));
+    if (!copy)
+      return -1;
+    memcpy(copy, bufs, count * sizeof(SSC_IoVec));
+  }
+#ifdef HAS_URING_
+  if (aio->backend == SSC_ASYNCIO_BACKEND_URING) {
+    if (e->buf_count)
+      syscall(SYS_io_uring_register, e->uring.fd, IORING_UNREGISTER_BUFFERS, SSC_NULL, 0);
+    if (count && syscall(SYS_io_uring_register, e->uring.fd, IORING_REGISTER_BUFFERS, copy, count)) {
+      free(copy);
+      copy = SSC_NULL;
+      count = 0;
+      err = -1;
+    }
+  }
+#endif
+  free(e->bufs);
+  e->bufs = copy;
+  e->buf_count = count;
+  return err;
+}
+
+SSC_Error_t SSC_AsyncIo_prepare(SSC_AsyncIo* R_ aio, const SSC_AsyncIoRequest* R_ req)
+{
+  Engine_* e = (Engine_*)aio->engine;
+  Slot_*   s;
+  unsigned i;
+
+  if (!SSC_AsyncIo_getFree(aio) || req->size > SSC_ASYNCIO_MAX_SIZE)
+    return -1;
+  if (req->op != SSC_ASYNCIO_OP_READ && req->op != SSC_ASYNCIO_OP_WRITE && req->op != SSC_ASYNCIO_OP_FSYNC)
+    return -1;
+  if ((req->flags & SSC_ASYNCIO_REQ_FIXED_FILE) && req->file_index >= e->file_count)
+    return -1;
+  if ((req->flags & SSC_ASYNCIO_REQ_FIXED_BUFFER) && req->op != SSC_ASYNCIO_OP_FSYNC) {
+    const SSC_IoVec* b;
+    uintptr_t lo, p;
+    if (req->buf_index >= e->buf_count)
+      return -1;
+    b  = e->bufs + req->buf_index;
+    lo = (uintptr_t)b->iov_base;
+    p  = (uintptr_t)req->buf;
+    if (p < lo || (p - lo) > b->iov_len || req->size > (b->iov_len - (p - lo)))
+      return -1; /* @buf isn't within the registered buffer. */
+  }
+  i = e->free[--e->free_count];
+  s = e->slots + i;
+  s->req = *req;
+  if (req->flags & SSC_ASYNCIO_REQ_FIXED_FILE)
+    s->req.file = e->files[req->file_index];
+  e->pending[aio->pending++] = i;
+  return 0;
+}
+
+SSC_Error_t SSC_AsyncIo_submit(SSC_AsyncIo* aio)
+{
+  Engine_* e = (Engine_*)aio->engine;
+  const unsigned n = aio->pending;
+  if (!n)
+    return 0;
+  /* Once queued, requests are in flight, even if the kernel has yet to take them up. */
+  aio->pending = 0;
+  aio->inflight += n;
+#ifdef HAS_URING_
+  if (aio->backend == SSC_ASYNCIO_BACKEND_URING)
+    return uringSubmit_(e, n);
+#endif
+  poolSubmit_(e, n);
+  return 0;
+}
+
+SSC_Error_t SSC_AsyncIo_reap(SSC_AsyncIo* R_ aio, SSC_AsyncIoCompletion* R_ completions, unsigned max, unsigned min, unsigned* R_ count)
+{
+  Engine_* e = (Engine_*)aio->engine;
+  SSC_Error_t err = 0;
+  unsigned got;
+  if (min > aio->inflight)
+    min = aio->inflight;
+  if (min > max)
+    min = max;
+#ifdef HAS_URING_
+  if (aio->backend == SSC_ASYNCIO_BACKEND_URING)
+    err = uringReap_(e, completions, max, min, &got);
+  else
+#endif
+  got = poolReap_(e, completions, max, min);
+  aio->inflight -= got;
+  *count = got;
+  return err;
+}
+
+void SSC_AsyncIo_del(SSC_AsyncIo* aio)
+{
+  Engine_* e = (Engine_*)aio->engine;
+  if (e) {
+    /* Requests in flight may still write into their buffers, so let them finish first. */
+    SSC_AsyncIoCompletion c[DRAIN_BATCH_];
+    unsigned n;
+    aio->pending = 0;
+    while (aio->inflight && !SSC_AsyncIo_reap(aio, c, DRAIN_BATCH_, 1, &n))
+      ;
+#ifdef HAS_URING_
+    uringDel_(&e->uring);
+#endif
+    if (aio->backend == SSC_ASYNCIO_BACKEND_THREADS)
+      poolDel_(&e->pool);
+    free(e->bufs);
+    free(e->files);
+    free(e->pending);
+    free(e->free);
+    free(e->slots);
+    free(e);
+  }
+  *aio = SSC_ASYNCIO_NULL_LITERAL;
+}
@@ -1,11 +1,29 @@
 /* Copyright (c) 2020-2023 Stuart Steven Calder
  * See accompanying LICENSE file for licensing information. */
 #include "File.h"
+#include "Memory.h"
 
 #define R_ SSC_RESTRICT
 
 #if   defined(SSC_OS_UNIXLIKE)
+#include <errno.h>
+#include <limits.h>
+ #if defined(__gnu_linux__)
+  #include <linux/fs.h> /* BLKSSZGET */
+  #include <sys/ioctl.h>
+  #include <sys/sysmacros.h>
+ #endif
 typedef struct stat   Stat_t;
+ #if   defined(IOV_MAX) && (IOV_MAX < 1024)
+  #define IOV_BATCH_ IOV_MAX
+ #elif defined(IOV_MAX)
+  #define IOV_BATCH_ 1024
+ #else
+  #define IOV_BATCH_ 16 /* The least IOV_MAX that POSIX allows. */
+ #endif
+ #if !defined(SSC_OS_MAC)
+  #define HAS_PREADV_ /* macOS lacks preadv() and pwritev() before 11.0. */
+ #endif
 #elif defined(SSC_OS_WINDOWS)
 typedef LARGE_INTEGER LargeInt_t;
 typedef DWORD         Dw32_t;
@@ -54,13 +72,14 @@ SSC_FilePath_getSize(const char* R_ fpath, size_t* R_ storesize)
 bool
 SSC_FilePath_exists(const char* filepath)
 {
-  bool exists = false;
-  FILE* test = fopen(filepath, "r");
-  if (test) {
-    fclose(test);
-    exists = true;
-  }
-  return exists;
+#if    defined(SSC_OS_UNIXLIKE)
+  Stat_t s;
+  return !stat(filepath, &s);
+#elif  defined(SSC_OS_WINDOWS)
+  return GetFileAttributesA(filepath) != INVALID_FILE_ATTRIBUTES;
+#else
+ #error "Unsupported operating system."
+#endif
 }
 
 void
@@ -86,6 +105,151 @@ SSC_FilePath_open(const char* R_ filepath, bool readonly, SSC_File_t* R_ storefi
   return (*storefile != SSC_FILE_NULL_LITERAL) ? 0 : -1;
 }
 
+#if defined(SSC_OS_UNIXLIKE)
+/* Return the open() flags that @flags asks for, beyond the access mode. */
+static int
+openFlags_(SSC_BitFlag_t flags)
+{
+  int f = 0;
+  if (flags & SSC_FILEPATH_OPEN_CLOEXEC)
+    f |= O_CLOEXEC;
+  if (flags & SSC_FILEPATH_OPEN_SYNC)
+    f |= O_SYNC;
+  if (flags & SSC_FILEPATH_OPEN_DSYNC)
+ #if defined(O_DSYNC)
+    f |= O_DSYNC;
+ #else
+    f |= O_SYNC;
+ #endif
+  return f;
+}
+
+/* Add the status flag @flag to @file, if the system and filesystem allow it. */
+static void
+addStatusFlag_(SSC_File_t file, int flag)
+{
+  const int f = fcntl(file, F_GETFL);
+  if (f != -1)
+    (void)fcntl(file, F_SETFL, f|flag);
+}
+
+/* Apply the optional flags of @flags to the newly opened @file. They are set after opening,
+ * rather than passed to open(), so that a filesystem refusing them can't fail the open. */
+static void
+setOptional_(SSC_File_t file, SSC_BitFlag_t flags)
+{
+  if (flags & SSC_FILEPATH_OPEN_DIRECT) {
+ #if   defined(O_DIRECT)
+    addStatusFlag_(file, O_DIRECT);
+ #elif defined(F_NOCACHE)
+    (void)fcntl(file, F_NOCACHE, 1);
+ #endif
+  }
+ #if defined(O_NOATIME)
+  if (flags & SSC_FILEPATH_OPEN_NOATIME)
+    addStatusFlag_(file, O_NOATIME);
+ #endif
+}
+#elif defined(SSC_OS_WINDOWS)
+/* Return the CreateFileA() flags and attributes that @flags asks for. */
+static Dw32_t
+openFlags_(SSC_BitFlag_t flags)
+{
+  Dw32_t f = FILE_ATTRIBUTE_NORMAL;
+  if (flags & SSC_FILEPATH_OPEN_DIRECT)
+    f |= FILE_FLAG_NO_BUFFERING;
+  if (flags & (SSC_FILEPATH_OPEN_SYNC|SSC_FILEPATH_OPEN_DSYNC))
+    f |= FILE_FLAG_WRITE_THROUGH;
+  return f;
+}
+
+static void
+setOptional_(SSC_File_t file, SSC_BitFlag_t flags)
+{
+  if (flags & SSC_FILEPATH_OPEN_NOATIME) {
+    /* A time of all ones stops this handle's accesses from updating the access time. */
+    FILETIME keep;
+    keep.dwLowDateTime  = 0xffffffff;
+    keep.dwHighDateTime = 0xffffffff;
+    (void)SetFileTime(file, SSC_NULL, &keep, SSC_NULL);
+  }
+}
+#endif
+
+SSC_CodeError_t
+SSC_FilePath_openOrCreate(const char* R_ filepath, SSC_BitFlag_t flags, SSC_File_t* R_ storefile, bool* R_ created)
+{
+  bool c = false;
+#if    defined(SSC_OS_UNIXLIKE)
+  const int oflags = openFlags_(flags);
+#elif  defined(SSC_OS_WINDOWS)
+  Dw32_t oflags = openFlags_(flags);
+#endif
+  /* When the file vanishes between failing to create it and opening it, or appears between
+   * failing to open it and creating it, try again. */
+  for (;;) {
+#if    defined(SSC_OS_UNIXLIKE)
+    if (!(flags & SSC_FILEPATH_OPEN_EXCLUSIVE)) {
+      *storefile = open(filepath, ((flags & SSC_FILEPATH_OPEN_READONLY) ? O_RDONLY : O_RDWR)|oflags);
+      if (*storefile != SSC_FILE_NULL_LITERAL)
+        break;
+      if (errno == EINTR)
+        continue;
+      if (errno != ENOENT)
+        return SSC_FILEPATH_OPEN_CODE_ERR_OPEN;
+      if (!(flags & SSC_FILEPATH_OPEN_CREATE))
+        return SSC_FILEPATH_OPEN_CODE_ERR_NOEXIST;
+    }
+    *storefile = open(filepath, (O_RDWR|O_CREAT|O_EXCL|oflags), (mode_t)0600);
+    if (*storefile != SSC_FILE_NULL_LITERAL) {
+      c = true;
+      break;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno != EEXIST)
+      return SSC_FILEPATH_OPEN_CODE_ERR_CREATE;
+#elif  defined(SSC_OS_WINDOWS)
+    Dw32_t err;
+    if (!(flags & SSC_FILEPATH_OPEN_EXCLUSIVE)) {
+      const Dw32_t rights = (flags & SSC_FILEPATH_OPEN_READONLY) ? GENERIC_READ : (GENERIC_READ|GENERIC_WRITE);
+      *storefile = CreateFileA(filepath, rights, 0, SSC_NULL, OPEN_EXISTING, oflags, SSC_NULL);
+      if (*storefile != SSC_FILE_NULL_LITERAL)
+        break;
+      err = GetLastError();
+      if (err == ERROR_INVALID_PARAMETER && (oflags & FILE_FLAG_NO_BUFFERING)) {
+        oflags &= ~(Dw32_t)FILE_FLAG_NO_BUFFERING; /* The filesystem refuses unbuffered I/O. */
+        continue;
+      }
+      if (err != ERROR_FILE_NOT_FOUND)
+        return SSC_FILEPATH_OPEN_CODE_ERR_OPEN;
+      if (!(flags & SSC_FILEPATH_OPEN_CREATE))
+        return SSC_FILEPATH_OPEN_CODE_ERR_NOEXIST;
+    }
+    *storefile = CreateFileA(filepath, (GENERIC_READ|GENERIC_WRITE), 0, SSC_NULL, CREATE_NEW, oflags, SSC_NULL);
+    if (*storefile != SSC_FILE_NULL_LITERAL) {
+      c = true;
+      break;
+    }
+    err = GetLastError();
+    if (err == ERROR_INVALID_PARAMETER && (oflags & FILE_FLAG_NO_BUFFERING)) {
+      oflags &= ~(Dw32_t)FILE_FLAG_NO_BUFFERING;
+      continue;
+    }
+    if (err != ERROR_FILE_EXISTS && err != ERROR_ALREADY_EXISTS)
+      return SSC_FILEPATH_OPEN_CODE_ERR_CREATE;
+#else
+ #error "Unsupported operating system."
+#endif
+    if (flags & SSC_FILEPATH_OPEN_EXCLUSIVE)
+      return SSC_FILEPATH_OPEN_CODE_ERR_EXIST;
+  }
+  setOptional_(*storefile, flags);
+  if (created)
+    *created = c;
+  return SSC_FILEPATH_OPEN_CODE_OK;
+}
+
 SSC_Error_t
 SSC_FilePath_create(const char* R_ filepath, SSC_File_t* R_ storefile)
 {
@@ -99,6 +263,294 @@ SSC_FilePath_create(const char* R_ filepath, SSC_File_t* R_ storefile)
   return (*storefile != SSC_FILE_NULL_LITERAL) ? 0 : -1;
 }
 
+#if defined(SSC_OS_WINDOWS)
+ #define IO_MAX_ 0x40000000 /* Transfer at most 1GiB per call, well within a DWORD. */
+
+/* Return an OVERLAPPED that directs a transfer to the file offset @offset. */
+static OVERLAPPED
+overlappedAt_(size_t offset)
+{
+  OVERLAPPED ov;
+  memset(&ov, 0, sizeof(ov));
+  ov.Offset     = (Dw32_t)((uint64_t)offset & UINT64_C(0xffffffff));
+  ov.OffsetHigh = (Dw32_t)((uint64_t)offset >> 32);
+  return ov;
+}
+#endif
+
+SSC_Error_t
+SSC_File_readAt(SSC_File_t file, void* R_ buf, size_t size, size_t offset, size_t* R_ readcount)
+{
+  uint8_t* p = (uint8_t*)buf;
+  size_t   done = 0;
+  while (done < size) {
+#if    defined(SSC_OS_UNIXLIKE)
+    const ssize_t r = pread(file, p + done, size - done, (off_t)(offset + done));
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+#elif  defined(SSC_OS_WINDOWS)
+    OVERLAPPED ov = overlappedAt_(offset + done);
+    Dw32_t r;
+    if (!ReadFile(file, p + done, (Dw32_t)(((size - done) < IO_MAX_) ? (size - done) : IO_MAX_), &r, &ov)) {
+      if (GetLastError() != ERROR_HANDLE_EOF)
+        return -1;
+      r = 0;
+    }
+#else
+ #error "Unsupported operating system."
+#endif
+    if (r == 0)
+      break; /* The end of the file. */
+    done += (size_t)r;
+  }
+  if (readcount)
+    *readcount = done;
+  else if (done != size)
+    return -1;
+  return 0;
+}
+
+SSC_Error_t
+SSC_File_writeAt(SSC_File_t file, const void* R_ buf, size_t size, size_t offset)
+{
+  const uint8_t* p = (const uint8_t*)buf;
+  size_t done = 0;
+  while (done < size) {
+#if    defined(SSC_OS_UNIXLIKE)
+    const ssize_t w = pwrite(file, p + done, size - done, (off_t)(offset + done));
+    if (w < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+#elif  defined(SSC_OS_WINDOWS)
+    OVERLAPPED ov = overlappedAt_(offset + done);
+    Dw32_t w;
+    if (!WriteFile(file, p + done, (Dw32_t)(((size - done) < IO_MAX_) ? (size - done) : IO_MAX_), &w, &ov))
+      return -1;
+#else
+ #error "Unsupported operating system."
+#endif
+    if (w == 0)
+      return -1; /* No progress is possible. */
+    done += (size_t)w;
+  }
+  return 0;
+}
+
+/* Transfer the @count buffers of @iov, writing when @write is true and reading otherwise, at
+ * @offset when @positional is true and at the file's position otherwise.
+ * Store the number of bytes transferred in @done. */
+static SSC_Error_t
+vectored_(
+ SSC_File_t           file,
+ const SSC_IoVec* R_  iov,
+ size_t               count,
+ bool                 write,
+ bool                 positional,
+ size_t               offset,
+ size_t* R_           done)
+{
+  size_t i = 0, skip = 0, total = 0; /* @skip bytes of @iov[@i] are already transferred. */
+  while (i < count) {
+    size_t left;
+    if (iov[i].iov_len == skip) {
+      ++i;
+      skip = 0;
+      continue; /* Never start a transfer with an empty buffer, so 0 always means no progress. */
+    }
+#if    defined(SSC_OS_UNIXLIKE)
+    SSC_IoVec batch[IOV_BATCH_];
+    int       n;
+    ssize_t   r;
+    /* Resume partway through the first buffer after a short transfer. */
+    batch[0].iov_base = (uint8_t*)iov[i].iov_base + skip;
+    batch[0].iov_len  = iov[i].iov_len - skip;
+    for (n = 1; (n < IOV_BATCH_) && ((i + (size_t)n) < count); ++n)
+      batch[n] = iov[i + (size_t)n];
+    if (positional) {
+ #ifdef HAS_PREADV_
+      const off_t at = (off_t)(offset + total);
+      r = write ? pwritev(file, batch, n, at) : preadv(file, batch, n, at);
+ #else
+      r = write ? pwrite(file, batch[0].iov_base, batch[0].iov_len, (off_t)(offset + total))
+                : pread(file, batch[0].iov_base, batch[0].iov_len, (off_t)(offset + total));
+ #endif
+    }
+    else
+      r = write ? writev(file, batch, n) : readv(file, batch, n);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+#elif  defined(SSC_OS_WINDOWS)
+    uint8_t* const p = (uint8_t*)iov[i].iov_base + skip;
+    const Dw32_t want = (Dw32_t)(((iov[i].iov_len - skip) < IO_MAX_) ? (iov[i].iov_len - skip) : IO_MAX_);
+    OVERLAPPED ov = overlappedAt_(offset + total);
+    Dw32_t r;
+    if (!(write ? WriteFile(file, p, want, &r, positional ? &ov : SSC_NULL)
+                : ReadFile(file, p, want, &r, positional ? &ov : SSC_NULL)))
+    {
+      if (write || GetLastError() != ERROR_HANDLE_EOF)
+        return -1;
+      r = 0;
+    }
+#else
+ #error "Unsupported operating system."
+#endif
+    if (r == 0) {
+      if (write)
+        return -1; /* No progress is possible. */
+      break;       /* The end of the file. */
+    }
+    total += (size_t)r;
+    /* Advance past the buffers the transfer completed. */
+    left = (size_t)r;
+    while (left) {
+      const size_t rest = iov[i].iov_len - skip;
+      if (left < rest) {
+        skip += left;
+        left = 0;
+      }
+      else {
+        left -= rest;
+        ++i;
+        skip = 0;
+      }
+    }
+  }
+  *done = total;
+  return 0;
+}
+
+/* Finish a vectored read of @done bytes from the @count buffers of @iov, as SSC_File_readAt() does. */
+static SSC_Error_t
+readCount_(const SSC_IoVec* R_ iov, size_t count, size_t done, size_t* R_ readcount)
+{
+  size_t size = 0;
+  if (readcount) {
+    *readcount = done;
+    return 0;
+  }
+  for (size_t i = 0; i < count; ++i)
+    size += iov[i].iov_len;
+  return (done == size) ? 0 : -1;
+}
+
+SSC_Error_t
+SSC_File_readv(SSC_File_t file, const SSC_IoVec* R_ iov, size_t count, size_t* R_ readcount)
+{
+  size_t done;
+  if (vectored_(file, iov, count, false, false, 0, &done))
+    return -1;
+  return readCount_(iov, count, done, readcount);
+}
+
+SSC_Error_t
+SSC_File_writev(SSC_File_t file, const SSC_IoVec* iov, size_t count)
+{
+  size_t done;
+  return vectored_(file, iov, count, true, false, 0, &done);
+}
+
+SSC_Error_t
+SSC_File_readvAt(SSC_File_t file, const SSC_IoVec* R_ iov, size_t count, size_t offset, size_t* R_ readcount)
+{
+  size_t done;
+  if (vectored_(file, iov, count, false, true, offset, &done))
+    return -1;
+  return readCount_(iov, count, done, readcount);
+}
+
+SSC_Error_t
+SSC_File_writevAt(SSC_File_t file, const SSC_IoVec* iov, size_t count, size_t offset)
+{
+  size_t done;
+  return vectored_(file, iov, count, true, true, offset, &done);
+}
+
+#if defined(__gnu_linux__)
+/* Return the logical block size sysfs reports for the block device @dev, or 0. */
+static size_t
+sysfsBlockSize_(dev_t dev)
+{
+  /* Partitions have no queue of their own; the queue of their disk is one directory up. */
+  static const char* const fmts[] = {
+   "/sys/dev/block/%u:%u/queue/logical_block_size",
+   "/sys/dev/block/%u:%u/../queue/logical_block_size"
+  };
+  char path[96];
+  for (int i = 0; i < 2; ++i) {
+    unsigned long n = 0;
+    FILE* f;
+    snprintf(path, sizeof(path), fmts[i], major(dev), minor(dev));
+    f = fopen(path, "r");
+    if (!f)
+      continue;
+    if (fscanf(f, "%lu", &n) != 1)
+      n = 0;
+    fclose(f);
+    if (n && !(n & (n - 1)))
+      return (size_t)n;
+  }
+  return 0;
+}
+#endif
+
+SSC_Error_t
+SSC_File_getDirectAlignment(SSC_File_t file, size_t* R_ alignment)
+{
+  size_t a = 0;
+#if    defined(SSC_OS_UNIXLIKE)
+  Stat_t s;
+  if (fstat(file, &s))
+    return -1;
+ #if defined(__gnu_linux__)
+  #if defined(STATX_DIOALIGN)
+  {
+    /* Since Linux 6.1, filesystems report their direct I/O alignment themselves. */
+    struct statx sx;
+    if (!statx(file, "", AT_EMPTY_PATH, STATX_DIOALIGN, &sx) && (sx.stx_mask & STATX_DIOALIGN) && sx.stx_dio_offset_align)
+      a = (sx.stx_dio_mem_align > sx.stx_dio_offset_align) ? sx.stx_dio_mem_align : sx.stx_dio_offset_align;
+  }
+  #endif
+  if (!a) {
+    int bs;
+    if (S_ISBLK(s.st_mode))
+      a = (!ioctl(file, BLKSSZGET, &bs) && bs > 0) ? (size_t)bs : 0;
+    else
+      a = sysfsBlockSize_(s.st_dev);
+  }
+ #endif
+#elif  defined(SSC_OS_WINDOWS)
+ #if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+  FILE_STORAGE_INFO info;
+  if (GetFileInformationByHandleEx(file, FileStorageInfo, &info, sizeof(info)))
+    a = (size_t)info.LogicalBytesPerSector;
+ #endif
+#else
+ #error "Unsupported operating system."
+#endif
+  if (!a || (a & (a - 1)))
+    a = SSC_getPageSize();
+  *alignment = a;
+  return 0;
+}
+
+void*
+SSC_File_directMalloc(SSC_File_t file, size_t* size)
+{
+  size_t a;
+  if (SSC_File_getDirectAlignment(file, &a) || *size > (SIZE_MAX - a))
+    return SSC_NULL;
+  *size = *size ? SSC_File_alignUp(*size, a) : a;
+  return SSC_alignedMalloc(a, *size);
+}
+
 #ifndef SSC_FILE_SETSIZE_INLINE
 SSC_Error_t
 SSC_File_setSize(SSC_File_t file, size_t size)
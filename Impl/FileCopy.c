@@ -0,0 +1,264 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "FileCopy.h"
+#include "MemMap.h"
+#define R_ SSC_RESTRICT
+
+#if   defined(SSC_OS_UNIXLIKE)
+ #include <errno.h>
+ #if defined(__gnu_linux__)
+  #include <linux/fs.h> /* FICLONE */
+  #include <sys/ioctl.h>
+  #include <sys/sendfile.h>
+  #include <sys/syscall.h>
+  #if defined(SYS_copy_file_range)
+   #define HAS_COPY_FILE_RANGE_
+  #endif
+  #define HAS_SPLICE_
+  #define HAS_SENDFILE_
+  #define PIPE_SIZE_ 0x100000 /* Ask for 1MiB pipes, rather than the default 64KiB. */
+ #elif defined(SSC_OS_MAC)
+  #include <sys/clonefile.h>
+ #endif
+#elif defined(SSC_OS_WINDOWS)
+ #include <windows.h>
+#else
+ #error "Unsupported operating system."
+#endif
+
+#define CHUNK_ 0x4000000 /* Copy at most 64MiB per call, or per mapping. */
+
+/* Return the smaller of @a and @b. */
+static size_t
+min_(size_t a, size_t b)
+{
+  return (a < b) ? a : b;
+}
+
+/* Clamp the @size bytes at @offset of @file to the end of the file. */
+static SSC_Error_t
+clamp_(SSC_File_t file, size_t offset, size_t* size)
+{
+  size_t end;
+  if (SSC_File_getSize(file, &end))
+    return -1;
+  if (offset >= end)
+    *size = 0;
+  else if (*size > (end - offset))
+    *size = end - offset;
+  return 0;
+}
+
+#if defined(__gnu_linux__)
+/* Did a faster method fail only because these files, or this system, don't support it?
+ * Then the copy may go on with the next method. */
+static bool
+unsupported_(int err)
+{
+  return err == ENOSYS || err == EINVAL || err == EXDEV || err == EOPNOTSUPP ||
+         err == ENOTSUP || err == EBADF;
+}
+#endif
+
+#ifdef HAS_COPY_FILE_RANGE_
+/* Copy with copy_file_range(), continuing from @done. On reaching the end of @src, set @size to @done. */
+static SSC_Error_t
+copyFileRange_(SSC_File_t dst, size_t dst_offset, SSC_File_t src, size_t src_offset, size_t* R_ size, size_t* R_ done)
+{
+  const size_t start = *done;
+  while (*done < *size) {
+    loff_t in  = (loff_t)(src_offset + *done);
+    loff_t out = (loff_t)(dst_offset + *done);
+    const long r = syscall(SYS_copy_file_range, src, &in, dst, &out, min_(*size - *done, CHUNK_), 0u);
+    if (r > 0)
+      *done += (size_t)r;
+    else if (r == 0) {
+      /* Some filesystems (e.g. procfs, sysfs) report nothing to copy from files with data. */
+      if (*done == start) {
+        errno = EINVAL;
+        return -1;
+      }
+      *size = *done;
+    } else if (errno != EINTR)
+      return -1;
+  }
+  return 0;
+}
+#endif
+
+#ifdef HAS_SPLICE_
+/* Copy through a pipe with splice(), continuing from @done. Only bytes that reached @dst are
+ * counted in @done, so a failure may be picked up from there by another method. */
+static SSC_Error_t
+spliceCopy_(SSC_File_t dst, size_t dst_offset, SSC_File_t src, size_t src_offset, size_t* R_ size, size_t* R_ done)
+{
+  SSC_Error_t err = 0;
+  size_t pipe_size = 0x10000;
+  int p[2];
+  if (pipe2(p, O_CLOEXEC))
+    return -1;
+ #ifdef F_SETPIPE_SZ
+  {
+    const int n = fcntl(p[1], F_SETPIPE_SZ, PIPE_SIZE_);
+    if (n > 0)
+      pipe_size = (size_t)n;
+  }
+ #endif
+  while (!err && *done < *size) {
+    loff_t in = (loff_t)(src_offset + *done);
+    ssize_t n = splice(src, &in, p[1], SSC_NULL, min_(*size - *done, pipe_size), SPLICE_F_MOVE);
+    if (n == 0)
+      *size = *done;
+    else if (n < 0)
+      err = (errno == EINTR) ? 0 : -1;
+    /* Drain the pipe into @dst completely, so that it is empty for the next round. */
+    while (!err && n > 0) {
+      loff_t out = (loff_t)(dst_offset + *done);
+      const ssize_t m = splice(p[0], SSC_NULL, dst, &out, (size_t)n, SPLICE_F_MOVE);
+      if (m > 0) {
+        n -= m;
+        *done += (size_t)m;
+      } else if (m == 0 || errno != EINTR)
+        err = -1;
+    }
+  }
+  close(p[0]);
+  close(p[1]);
+  return err;
+}
+#endif
+
+/* Copy a chunk at a time, from a mapping of @src straight into @dst, continuing from @done.
+ * When @positional is false, write at the position of @dst, and ignore @dst_offset. */
+static SSC_Error_t
+mappedCopy_(SSC_File_t dst, size_t dst_offset, SSC_File_t src, size_t src_offset, size_t size, bool positional, size_t* R_ done)
+{
+  SSC_MemMap m = SSC_MEMMAP_NULL_LITERAL;
+  m.file = src;
+  while (*done < size) {
+    const size_t n = min_(size - *done, CHUNK_);
+    SSC_Error_t err;
+    if (SSC_MemMap_mapRange(&m, src_offset + *done, n, SSC_MEMMAP_MAP_READONLY))
+      return -1;
+    SSC_MemMap_advise(&m, SSC_MEMMAP_ADVICE_SEQUENTIAL);
+    if (positional)
+      err = SSC_File_writeAt(dst, m.ptr, n, dst_offset + *done);
+    else {
+      SSC_IoVec v;
+      v.iov_base = m.ptr;
+      v.iov_len  = n;
+      err = SSC_File_writev(dst, &v, 1);
+    }
+    SSC_MemMap_unmap(&m);
+    if (err)
+      return -1;
+    *done += n;
+  }
+  return 0;
+}
+
+SSC_Error_t SSC_FileCopy_range(
+ SSC_File_t    dst,
+ size_t        dst_offset,
+ SSC_File_t    src,
+ size_t        src_offset,
+ size_t        size,
+ SSC_BitFlag_t flags,
+ size_t* R_    copied)
+{
+  const size_t requested = size;
+  size_t done = 0;
+  if (clamp_(src, src_offset, &size))
+    return -1;
+#ifdef HAS_COPY_FILE_RANGE_
+  if (!(flags & SSC_FILECOPY_NOCLONE) && copyFileRange_(dst, dst_offset, src, src_offset, &size, &done) && !unsupported_(errno))
+    return -1;
+#else
+  (void)flags;
+#endif
+#ifdef HAS_SPLICE_
+  if ((done < size) && spliceCopy_(dst, dst_offset, src, src_offset, &size, &done) && !unsupported_(errno))
+    return -1;
+#endif
+  if (mappedCopy_(dst, dst_offset, src, src_offset, size, true, &done))
+    return -1;
+  if (copied)
+    *copied = done;
+  else if (done != requested)
+    return -1;
+  return 0;
+}
+
+SSC_Error_t SSC_FileCopy_file(SSC_File_t dst, SSC_File_t src, SSC_BitFlag_t flags)
+{
+  size_t size;
+#ifdef FICLONE
+  /* A clone replaces the contents of @dst, and its size, all at once. */
+  if (!(flags & SSC_FILECOPY_NOCLONE) && !ioctl(dst, FICLONE, src))
+    return 0;
+#endif
+  if (SSC_File_getSize(src, &size) || SSC_File_setSize(dst, 0))
+    return -1;
+  /* @src shrinking mid-copy would leave @dst short, so that is an error. */
+  return SSC_FileCopy_range(dst, 0, src, 0, size, flags, SSC_NULL);
+}
+
+SSC_Error_t SSC_FileCopy_path(const char* R_ dst_path, const char* R_ src_path, SSC_BitFlag_t flags)
+{
+#if   defined(SSC_OS_WINDOWS)
+  (void)flags;
+  return CopyFileA(src_path, dst_path, FALSE) ? 0 : -1;
+#else
+  SSC_File_t src, dst;
+  SSC_Error_t err;
+  bool created;
+ #ifdef SSC_OS_MAC
+  /* clonefile() only creates new files; when @dst_path exists, copy into it instead. */
+  if (!(flags & SSC_FILECOPY_NOCLONE) && !clonefile(src_path, dst_path, 0))
+    return 0;
+ #endif
+  if (SSC_FilePath_open(src_path, true, &src))
+    return -1;
+  if (SSC_FilePath_openOrCreate(dst_path, SSC_FILEPATH_OPEN_CREATE, &dst, &created)) {
+    SSC_File_close(src);
+    return -1;
+  }
+  err = SSC_FileCopy_file(dst, src, flags);
+  if (SSC_File_close(dst))
+    err = -1;
+  SSC_File_close(src);
+  if (err && created)
+    remove(dst_path);
+  return err;
+#endif
+}
+
+SSC_Error_t SSC_FileCopy_send(SSC_File_t out, SSC_File_t src, size_t src_offset, size_t size, size_t* R_ sent)
+{
+  const size_t requested = size;
+  size_t done = 0;
+  if (clamp_(src, src_offset, &size))
+    return -1;
+#ifdef HAS_SENDFILE_
+  while (done < size) {
+    off_t in = (off_t)(src_offset + done);
+    const ssize_t r = sendfile(out, src, &in, min_(size - done, CHUNK_));
+    if (r > 0)
+      done += (size_t)r;
+    else if (r == 0)
+      size = done;
+    else if (errno != EINTR) {
+      if (!unsupported_(errno))
+        return -1;
+      break;
+    }
+  }
+#endif
+  if (mappedCopy_(out, 0, src, src_offset, size, false, &done))
+    return -1;
+  if (sent)
+    *sent = done;
+  else if (done != requested)
+    return -1;
+  return 0;
+}
@@ -0,0 +1,248 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "HashIndex.h"
+#define R_ SSC_RESTRICT
+
+#define HEADER_SIZE_ SSC_HASHINDEX_HEADER_SIZE
+#define BUCKET_SIZE_ SSC_HASHINDEX_BUCKET_SIZE
+#define SLOT_SIZE_   16
+#define SLOTS_       (BUCKET_SIZE_ / SLOT_SIZE_)
+/* Header field offsets. */
+#define MAGIC_        0
+#define VERSION_      8
+#define BUCKET_COUNT_ 16
+#define COUNT_        24
+#define HEAP_SIZE_    32
+/* Slot field offsets. */
+#define TAG_      0
+#define KEY_SIZE_ 4
+#define RECORD_   8
+
+#define OK_          SSC_HASHINDEX_INIT_CODE_OK
+#define ERR_MAP_     SSC_HASHINDEX_INIT_CODE_ERR_MAP
+#define ERR_MAGIC_   SSC_HASHINDEX_INIT_CODE_ERR_MAGIC
+#define ERR_VERSION_ SSC_HASHINDEX_INIT_CODE_ERR_VERSION
+#define ERR_CORRUPT_ SSC_HASHINDEX_INIT_CODE_ERR_CORRUPT
+
+static const uint8_t magic_[8] = {'S', 'S', 'C', 'H', 'S', 'I', 'D', 'X'};
+
+/* Return the nonzero slot tag of @hash. */
+static uint32_t
+tag_(uint64_t hash)
+{
+  const uint32_t t = (uint32_t)(hash >> 32);
+  return t ? t : 1;
+}
+
+uint64_t SSC_HashIndex_hash(const void* key, size_t key_size)
+{
+  const uint8_t* k = (const uint8_t*)key;
+  uint64_t h = UINT64_C(0xcbf29ce484222325);
+  for (size_t i = 0; i < key_size; ++i) {
+    h ^= k[i];
+    h *= UINT64_C(0x100000001b3);
+  }
+  return h;
+}
+
+SSC_CodeError_t SSC_HashIndex_init(SSC_HashIndex* R_ idx, const char* R_ filepath, SSC_BitFlag_t flags)
+{
+  SSC_BitFlag_t mflags = SSC_MEMMAP_INIT_READONLY|SSC_MEMMAP_INIT_FORCE_EXIST|SSC_MEMMAP_INIT_FORCE_EXIST_YES|
+                         SSC_MEMMAP_INIT_ADVISE_RANDOM;
+  SSC_CodeError_t ce = OK_;
+  uint64_t bucket_count, heap_size, count, avail;
+
+  *idx = SSC_HASHINDEX_NULL_LITERAL;
+  if (flags & SSC_HASHINDEX_INIT_PREFAULT)
+    mflags |= SSC_MEMMAP_INIT_PREFAULT;
+  if (SSC_MemMap_init(&idx->map, filepath, 0, mflags))
+    ce = ERR_MAP_;
+  else if (idx->map.size < HEADER_SIZE_ || memcmp(idx->map.ptr + MAGIC_, magic_, sizeof(magic_)))
+    ce = ERR_MAGIC_;
+  else if (SSC_loadLittleEndian32(idx->map.ptr + VERSION_) != SSC_HASHINDEX_VERSION)
+    ce = ERR_VERSION_;
+  if (!ce) {
+    bucket_count = SSC_loadLittleEndian64(idx->map.ptr + BUCKET_COUNT_);
+    count        = SSC_loadLittleEndian64(idx->map.ptr + COUNT_);
+    heap_size    = SSC_loadLittleEndian64(idx->map.ptr + HEAP_SIZE_);
+    avail        = (uint64_t)(idx->map.size - HEADER_SIZE_);
+    if (bucket_count == 0 || (bucket_count & (bucket_count - 1)) ||
+        bucket_count > (avail / BUCKET_SIZE_) ||
+        heap_size > (avail - (bucket_count * BUCKET_SIZE_)) ||
+        count > (bucket_count * SLOTS_))
+      ce = ERR_CORRUPT_;
+  }
+  if (ce) {
+    SSC_MemMap_del(&idx->map);
+    *idx = SSC_HASHINDEX_NULL_LITERAL;
+    return ce;
+  }
+  idx->buckets   = idx->map.ptr + HEADER_SIZE_;
+  idx->heap      = idx->buckets + (bucket_count * BUCKET_SIZE_);
+  idx->heap_size = (size_t)heap_size;
+  idx->mask      = bucket_count - 1;
+  idx->count     = (size_t)count;
+  return OK_;
+}
+
+void SSC_HashIndex_initOrDie(SSC_HashIndex* R_ idx, const char* R_ filepath, SSC_BitFlag_t flags)
+{
+  const char* err_str;
+  switch (SSC_HashIndex_init(idx, filepath, flags)) {
+    case OK_:
+      return;
+    case ERR_MAP_:
+      err_str = "Failed to map the file";
+      break;
+    case ERR_MAGIC_:
+      err_str = "The file is not a hash index";
+      break;
+    case ERR_VERSION_:
+      err_str = "Unsupported hash index version";
+      break;
+    case ERR_CORRUPT_:
+      err_str = "The hash index geometry exceeds the file";
+      break;
+    default:
+      err_str = "Invalid SSC_CodeError_t";
+      break;
+  }
+  SSC_errx("Error: %s in SSC_HashIndex_initOrDie() for ``%s''!\n", err_str, filepath);
+}
+
+bool SSC_HashIndex_find(const SSC_HashIndex* R_ idx, const void* R_ key, size_t key_size, uint64_t* R_ value)
+{
+  const uint64_t hash = SSC_HashIndex_hash(key, key_size);
+  const uint32_t tag  = tag_(hash);
+  uint64_t b = hash & idx->mask;
+
+  /* Probe bucket after bucket, until a free slot shows that the key was never placed further on. */
+  for (uint64_t probes = 0; probes <= idx->mask; ++probes, b = (b + 1) & idx->mask) {
+    const uint8_t* slot = idx->buckets + (b * BUCKET_SIZE_);
+    for (int s = 0; s < SLOTS_; ++s, slot += SLOT_SIZE_) {
+      const uint32_t t = SSC_loadLittleEndian32(slot + TAG_);
+      uint64_t record;
+      if (t == 0)
+        return false;
+      if (t != tag || SSC_loadLittleEndian32(slot + KEY_SIZE_) != key_size)
+        continue;
+      record = SSC_loadLittleEndian64(slot + RECORD_);
+      /* Never trust the file to keep records within the heap. */
+      if (record > idx->heap_size || (8 + (uint64_t)key_size) > (idx->heap_size - record))
+        continue;
+      if (!memcmp(idx->heap + record + 8, key, key_size)) {
+        *value = SSC_loadLittleEndian64(idx->heap + record);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void SSC_HashIndex_del(SSC_HashIndex* idx)
+{
+  SSC_MemMap_del(&idx->map);
+  *idx = SSC_HASHINDEX_NULL_LITERAL;
+}
+
+SSC_Error_t SSC_HashIndexBuilder_add(SSC_HashIndexBuilder* R_ builder, const void* R_ key, size_t key_size, uint64_t value)
+{
+  SSC_HashIndexBuilderEntry* e;
+  const size_t record_size = 8 + key_size;
+
+  if (key_size > UINT32_MAX || key_size > (SIZE_MAX - builder->heap_size - 8))
+    return -1;
+  if (builder->count == builder->capacity) {
+    const size_t cap = builder->capacity ? (builder->capacity * 2) : 64;
+    e = (SSC_HashIndexBuilderEntry*)realloc(builder->entries, cap * sizeof(*e));
+    if (!e)
+      return -1;
+    builder->entries = e;
+    builder->capacity = cap;
+  }
+  if ((builder->heap_capacity - builder->heap_size) < record_size) {
+    size_t cap = builder->heap_capacity ? builder->heap_capacity : 4096;
+    uint8_t* heap;
+    while ((cap - builder->heap_size) < record_size)
+      cap *= 2;
+    heap = (uint8_t*)realloc(builder->heap, cap);
+    if (!heap)
+      return -1;
+    builder->heap = heap;
+    builder->heap_capacity = cap;
+  }
+  SSC_storeLittleEndian64(builder->heap + builder->heap_size, value);
+  if (key_size)
+    memcpy(builder->heap + builder->heap_size + 8, key, key_size);
+  e = builder->entries + builder->count++;
+  e->hash = SSC_HashIndex_hash(key, key_size);
+  e->record = (uint64_t)builder->heap_size;
+  e->key_size = (uint32_t)key_size;
+  builder->heap_size += record_size;
+  return 0;
+}
+
+SSC_Error_t SSC_HashIndexBuilder_write(const SSC_HashIndexBuilder* R_ builder, const char* R_ filepath)
+{
+  SSC_MemMap map = SSC_MEMMAP_NULL_LITERAL;
+  uint64_t bucket_count = 1;
+  uint8_t* buckets;
+  size_t   size;
+
+  /* Keep at most 3 of every 4 slots full, so that probes end quickly. */
+  while ((bucket_count * 3) < builder->count)
+    bucket_count *= 2;
+  if (bucket_count > ((SIZE_MAX - HEADER_SIZE_ - builder->heap_size) / BUCKET_SIZE_))
+    return -1;
+  size = HEADER_SIZE_ + ((size_t)bucket_count * BUCKET_SIZE_) + builder->heap_size;
+  if (SSC_MemMap_init(&map, filepath, size, SSC_MEMMAP_INIT_ALLOWSHRINK)) {
+    SSC_MemMap_del(&map);
+    return -1;
+  }
+  memset(map.ptr, 0, HEADER_SIZE_ + ((size_t)bucket_count * BUCKET_SIZE_));
+  buckets = map.ptr + HEADER_SIZE_;
+  /* Place the entries in the order they were added, so that the first of duplicate keys is found first. */
+  for (size_t i = 0; i < builder->count; ++i) {
+    const SSC_HashIndexBuilderEntry* e = builder->entries + i;
+    uint64_t b = e->hash & (bucket_count - 1);
+    uint8_t* slot = SSC_NULL;
+    while (!slot) {
+      uint8_t* s = buckets + (b * BUCKET_SIZE_);
+      for (int j = 0; j < SLOTS_; ++j, s += SLOT_SIZE_) {
+        if (!SSC_loadLittleEndian32(s + TAG_)) {
+          slot = s;
+          break;
+        }
+      }
+      b = (b + 1) & (bucket_count - 1);
+    }
+    SSC_storeLittleEndian32(slot + TAG_, tag_(e->hash));
+    SSC_storeLittleEndian32(slot + KEY_SIZE_, e->key_size);
+    SSC_storeLittleEndian64(slot + RECORD_, e->record);
+  }
+  if (builder->heap_size)
+    memcpy(buckets + ((size_t)bucket_count * BUCKET_SIZE_), builder->heap, builder->heap_size);
+  SSC_storeLittleEndian32(map.ptr + VERSION_, SSC_HASHINDEX_VERSION);
+  SSC_storeLittleEndian64(map.ptr + BUCKET_COUNT_, bucket_count);
+  SSC_storeLittleEndian64(map.ptr + COUNT_, (uint64_t)builder->count);
+  SSC_storeLittleEndian64(map.ptr + HEAP_SIZE_, (uint64_t)builder->heap_size);
+  /* Write the magic last, so that a crash never leaves a file that looks like a whole index. */
+  if (SSC_MemMap_sync(&map)) {
+    SSC_MemMap_del(&map);
+    return -1;
+  }
+  memcpy(map.ptr + MAGIC_, magic_, sizeof(magic_));
+  if (SSC_MemMap_syncRange(&map, 0, HEADER_SIZE_, 0)) {
+    SSC_MemMap_del(&map);
+    return -1;
+  }
+  SSC_MemMap_del(&map);
+  return 0;
+}
+
+void SSC_HashIndexBuilder_del(SSC_HashIndexBuilder* builder)
+{
+  free(builder->entries);
+  free(builder->heap);
+  *builder = SSC_HASHINDEXBUILDER_NULL_LITERAL;
+}
@@ -0,0 +1,292 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "Journal.h"
+#include "Atomic.h"
+#include "Memory.h"
+#define R_ SSC_RESTRICT
+
+#define HEADER_SIZE_ SSC_JOURNAL_HEADER_SIZE
+#define RECORD_HEADER_SIZE_ 8
+/* Header field offsets. */
+#define MAGIC_   0
+#define VERSION_ 8
+#define COMMIT_  16
+
+#define OK_          SSC_JOURNAL_INIT_CODE_OK
+#define ERR_MAP_     SSC_JOURNAL_INIT_CODE_ERR_MAP
+#define ERR_MAGIC_   SSC_JOURNAL_INIT_CODE_ERR_MAGIC
+#define ERR_VERSION_ SSC_JOURNAL_INIT_CODE_ERR_VERSION
+#define ERR_CORRUPT_ SSC_JOURNAL_INIT_CODE_ERR_CORRUPT
+#define ERR_RECOVER_ SSC_JOURNAL_INIT_CODE_ERR_RECOVER
+
+static const uint8_t magic_[8] = {'S', 'S', 'C', 'J', 'R', 'N', 'A', 'L'};
+
+/* Round @n up to a multiple of 8. */
+static size_t
+pad8_(size_t n)
+{
+  return (n + 7) & ~(size_t)7;
+}
+
+/* Return the 32-bit FNV-1a hash of the @n bytes at @p. */
+static uint32_t
+fnv1a_(const uint8_t* p, size_t n)
+{
+  uint32_t h = UINT32_C(0x811c9dc5);
+  for (size_t i = 0; i < n; ++i) {
+    h ^= p[i];
+    h *= UINT32_C(0x01000193);
+  }
+  return h;
+}
+
+/* Atomically load the record header at @off. Return false if it is unpublished. */
+static bool
+loadRecord_(const SSC_Journal* R_ journal, size_t off, uint32_t* R_ len, uint32_t* R_ cksum)
+{
+  uint8_t  buf[RECORD_HEADER_SIZE_];
+  uint64_t word = SSC_atomicLoad64((const volatile uint64_t*)(journal->map.ptr + off));
+  if (word == 0)
+    return false;
+  memcpy(buf, &word, sizeof(buf));
+  *len   = SSC_loadLittleEndian32(buf);
+  *cksum = SSC_loadLittleEndian32(buf + 4);
+  return true;
+}
+
+/* Return the offset just past the run of published records beginning at @off.
+ * When @verify is true, records must also match their checksums. */
+static size_t
+scan_(const SSC_Journal* journal, size_t off, bool verify)
+{
+  const size_t size = journal->map.size;
+  uint32_t len, cksum;
+
+  while ((size - off) >= RECORD_HEADER_SIZE_ && loadRecord_(journal, off, &len, &cksum)) {
+    const size_t n = RECORD_HEADER_SIZE_ + pad8_(len);
+    if (n > (size - off))
+      break;
+    if (verify && fnv1a_(journal->map.ptr + off + RECORD_HEADER_SIZE_, len) != cksum)
+      break;
+    off += n;
+  }
+  return off;
+}
+
+/* Store the commit marker @off and synchronize the header. */
+static SSC_Error_t
+storeCommit_(SSC_Journal* journal, size_t off)
+{
+  SSC_storeLittleEndian64(journal->map.ptr + COMMIT_, (uint64_t)off);
+  if (SSC_MemMap_syncRange(&journal->map, 0, HEADER_SIZE_, 0))
+    return -1;
+  journal->committed = off;
+  return 0;
+}
+
+/* Size and map the file just created in @journal->map.file, and write an empty journal to it. */
+static SSC_CodeError_t
+create_(SSC_Journal* journal, size_t capacity)
+{
+  if (capacity <= HEADER_SIZE_)
+    capacity = SSC_getPageSize();
+  journal->map.size = capacity;
+  if (SSC_File_setSize(journal->map.file, capacity) || SSC_MemMap_map(&journal->map, false))
+    return ERR_MAP_;
+  memset(journal->map.ptr, 0, HEADER_SIZE_);
+  memcpy(journal->map.ptr + MAGIC_, magic_, sizeof(magic_));
+  SSC_storeLittleEndian32(journal->map.ptr + VERSION_, SSC_JOURNAL_VERSION);
+  if (storeCommit_(journal, HEADER_SIZE_))
+    return ERR_MAP_;
+  journal->tail = HEADER_SIZE_;
+  return OK_;
+}
+
+/* Map and validate the existing journal opened in @journal->map.file. */
+static SSC_CodeError_t
+open_(SSC_Journal* journal, size_t capacity, SSC_BitFlag_t flags)
+{
+  uint64_t commit;
+  size_t   end, size;
+
+  if (SSC_File_getSize(journal->map.file, &size))
+    return ERR_MAP_;
+  if (size < HEADER_SIZE_)
+    return ERR_MAGIC_;
+  journal->map.size = size;
+  if (SSC_MemMap_map(&journal->map, (flags & SSC_JOURNAL_INIT_READONLY)))
+    return ERR_MAP_;
+  if (memcmp(journal->map.ptr + MAGIC_, magic_, sizeof(magic_)))
+    return ERR_MAGIC_;
+  if (SSC_loadLittleEndian32(journal->map.ptr + VERSION_) != SSC_JOURNAL_VERSION)
+    return ERR_VERSION_;
+  commit = SSC_loadLittleEndian64(journal->map.ptr + COMMIT_);
+  if (commit < HEADER_SIZE_ || commit > size || (commit % 8))
+    return ERR_CORRUPT_;
+  /* Keep the intact records that were published, but not committed, before closing. */
+  end = scan_(journal, (size_t)commit, true);
+  journal->committed = end;
+  if (journal->map.readonly) {
+    journal->tail = size;
+    return OK_;
+  }
+  if (capacity < size)
+    capacity = size;
+  /* Truncating away the torn tail and extending again leaves zeroes, marking the space unpublished. */
+  if (end < size) {
+    if (SSC_MemMap_resize(&journal->map, end) || SSC_MemMap_resize(&journal->map, capacity))
+      return ERR_RECOVER_;
+  }
+  else if (capacity > size && SSC_MemMap_resize(&journal->map, capacity))
+    return ERR_MAP_;
+  if (end != commit && storeCommit_(journal, end))
+    return ERR_RECOVER_;
+  journal->tail = end;
+  return OK_;
+}
+
+SSC_CodeError_t SSC_Journal_init(
+ SSC_Journal* R_ journal,
+ const char* R_  filepath,
+ size_t          capacity,
+ SSC_BitFlag_t   flags)
+{
+  SSC_BitFlag_t   oflags = SSC_FILEPATH_OPEN_CREATE;
+  SSC_CodeError_t ce;
+  bool            created = false;
+
+  /* There is nothing to open readonly, so only create when writing. */
+  if (flags & SSC_JOURNAL_INIT_READONLY)
+    oflags = SSC_FILEPATH_OPEN_READONLY;
+  *journal = SSC_JOURNAL_NULL_LITERAL;
+  /* Let the open decide whether the journal exists, rather than asking first. */
+  if (SSC_FilePath_openOrCreate(filepath, oflags, &journal->map.file, &created))
+    ce = ERR_MAP_;
+  else if (created)
+    ce = create_(journal, capacity);
+  else
+    ce = open_(journal, capacity, flags);
+  if (ce) {
+    SSC_MemMap_del(&journal->map);
+    *journal = SSC_JOURNAL_NULL_LITERAL;
+    if (created)
+      remove(filepath);
+  }
+  return ce;
+}
+
+void SSC_Journal_initOrDie(
+ SSC_Journal* R_ journal,
+ const char* R_  filepath,
+ size_t          capacity,
+ SSC_BitFlag_t   flags)
+{
+  const char* err_str;
+  switch (SSC_Journal_init(journal, filepath, capacity, flags)) {
+    case OK_:
+      return;
+    case ERR_MAP_:
+      err_str = "Failed to map the file";
+      break;
+    case ERR_MAGIC_:
+      err_str = "The file is not a journal";
+      break;
+    case ERR_VERSION_:
+      err_str = "Unsupported journal version";
+      break;
+    case ERR_CORRUPT_:
+      err_str = "The commit marker is corrupt";
+      break;
+    case ERR_RECOVER_:
+      err_str = "Failed to truncate torn records";
+      break;
+    default:
+      err_str = "Invalid SSC_CodeError_t";
+      break;
+  }
+  SSC_errx("Error: %s in SSC_Journal_initOrDie() for ``%s''!\n", err_str, filepath);
+}
+
+uint8_t* SSC_Journal_reserve(SSC_Journal* journal, size_t size)
+{
+  size_t n, off;
+
+  if (journal->map.readonly || size > UINT32_MAX)
+    return SSC_NULL;
+  n = RECORD_HEADER_SIZE_ + pad8_(size);
+  off = SSC_atomicFetchAddSize(&journal->tail, n);
+  /* Space past the capacity is never handed out; SSC_Journal_grow() rewinds @tail. */
+  if (off > journal->map.size || n > (journal->map.size - off))
+    return SSC_NULL;
+  return journal->map.ptr + off + RECORD_HEADER_SIZE_;
+}
+
+void SSC_Journal_publish(SSC_Journal* R_ journal, uint8_t* R_ payload, size_t size)
+{
+  uint8_t  buf[RECORD_HEADER_SIZE_];
+  uint64_t word;
+
+  (void)journal; /* Only checked in debug builds. */
+  SSC_ASSERT_MSG(
+   payload >= (journal->map.ptr + HEADER_SIZE_ + RECORD_HEADER_SIZE_) &&
+   size <= (size_t)((journal->map.ptr + journal->map.size) - payload),
+   "Error: SSC_Journal_publish() given a payload outside the journal!\n");
+  SSC_storeLittleEndian32(buf, (uint32_t)size);
+  SSC_storeLittleEndian32(buf + 4, fnv1a_(payload, size));
+  memcpy(&word, buf, sizeof(word));
+  /* The release store orders the payload before the header that publishes it. */
+  SSC_atomicStore64((volatile uint64_t*)(payload - RECORD_HEADER_SIZE_), word);
+}
+
+SSC_Error_t SSC_Journal_append(SSC_Journal* R_ journal, const void* R_ data, size_t size)
+{
+  uint8_t* p = SSC_Journal_reserve(journal, size);
+  if (!p)
+    return -1;
+  memcpy(p, data, size);
+  SSC_Journal_publish(journal, p, size);
+  return 0;
+}
+
+SSC_Error_t SSC_Journal_commit(SSC_Journal* journal)
+{
+  const size_t end = scan_(journal, journal->committed, false);
+
+  if (end == journal->committed)
+    return 0;
+  /* The records must be durable before the marker that commits them. */
+  if (SSC_MemMap_syncRange(&journal->map, journal->committed, end - journal->committed, 0))
+    return -1;
+  return storeCommit_(journal, end);
+}
+
+const uint8_t* SSC_Journal_next(const SSC_Journal* R_ journal, size_t* R_ cursor, size_t* R_ size)
+{
+  const uint8_t* p;
+  uint32_t len;
+
+  if (*cursor >= journal->committed)
+    return SSC_NULL;
+  p = journal->map.ptr + *cursor;
+  len = SSC_loadLittleEndian32(p);
+  *size = len;
+  *cursor += RECORD_HEADER_SIZE_ + pad8_(len);
+  return p + RECORD_HEADER_SIZE_;
+}
+
+SSC_Error_t SSC_Journal_grow(SSC_Journal* journal, size_t capacity)
+{
+  if (journal->map.readonly)
+    return -1;
+  /* Reservations that failed for lack of space advanced @tail past the published records. */
+  journal->tail = scan_(journal, journal->committed, false);
+  if (capacity <= journal->map.size)
+    return 0;
+  return SSC_MemMap_resize(&journal->map, capacity);
+}
+
+void SSC_Journal_del(SSC_Journal* journal)
+{
+  SSC_MemMap_del(&journal->map);
+  *journal = SSC_JOURNAL_NULL_LITERAL;
+}
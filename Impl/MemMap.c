@@ -1,6 +1,9 @@
 /* Copyright (c) 2020-2023 Stuart Steven Calder
  * See accompanying LICENSE file for licensing information. */
 #include "MemMap.h"
+#include "Atomic.h"
+#include "Memory.h"
+#include "Thread.h"
 #define R_ SSC_RESTRICT
 
 #if   defined(SSC_OS_UNIXLIKE)
@@ -11,34 +14,177 @@
 #else
  #error "Unsupported."
 #endif
+#if defined(__gnu_linux__)
+ #include <sys/vfs.h>
+ #define HUGETLBFS_MAGIC_ 0x958458f6
+#endif
+#if defined(SSC_OS_UNIXLIKE)
+ #include <errno.h>
+ #include <inttypes.h>
+ #if defined(MAP_ANONYMOUS)
+  #define MAP_ANON_ MAP_ANONYMOUS
+ #else
+  #define MAP_ANON_ MAP_ANON
+ #endif
+ #if !defined(MFD_CLOEXEC) && !defined(SHM_ANON)
+  #include "Random.h"
+ #endif
+#endif
+
+/* If @file resides on a hugetlbfs filesystem, return the size of its huge pages.
+ * Otherwise return 0. */
+static size_t
+hugetlbfsPageSize_(SSC_File_t file)
+{
+#if defined(__gnu_linux__)
+  struct statfs sfs;
+  if (!fstatfs(file, &sfs) && ((uint64_t)sfs.f_type == (uint64_t)HUGETLBFS_MAGIC_))
+    return (size_t)sfs.f_bsize;
+#endif
+  return 0;
+}
+
+/* Return the size of the default explicit huge pages, or 0 if there are none. */
+static size_t
+defaultHugePageSize_(void)
+{
+  size_t kib = 0;
+#if defined(__gnu_linux__)
+  char line[128];
+  FILE* meminfo = fopen("/proc/meminfo", "r");
+  if (!meminfo)
+    return 0;
+  while (fgets(line, sizeof(line), meminfo)) {
+    if (sscanf(line, "Hugepagesize: %zu kB", &kib) == 1)
+      break;
+    kib = 0;
+  }
+  fclose(meminfo);
+#endif
+  return kib * 1024;
+}
+
+/* Round @n up to a multiple of the power of 2 @align. */
+static size_t
+roundUp_(size_t n, size_t align)
+{
+  return (n + (align - 1)) & ~(align - 1);
+}
 
-SSC_Error_t SSC_MemMap_map(SSC_MemMap* map, bool readonly) 
+/* Ask the OS to back @map with transparent huge pages.
+ * This is only a hint, so failure is ignored. */
+static void
+adviseHugePage_(const SSC_MemMap* map)
 {
+#if defined(MADV_HUGEPAGE)
+  madvise((void*)map->base, SSC_MemMap_baseSize(map), MADV_HUGEPAGE);
+#endif
+}
+
+SSC_Error_t SSC_MemMap_map(SSC_MemMap* map, bool readonly)
+{
+  return SSC_MemMap_mapRange(map, 0, map->size, readonly ? SSC_MEMMAP_MAP_READONLY : 0);
+}
+
+SSC_Error_t SSC_MemMap_mapRange(SSC_MemMap* map, size_t offset, size_t size, SSC_BitFlag_t flags)
+{
+  const bool readonly    = (flags & SSC_MEMMAP_MAP_READONLY);
+  const bool cow         = (flags & SSC_MEMMAP_MAP_PRIVATE);
+  bool       prefault    = (flags & SSC_MEMMAP_MAP_PREFAULT);
+  size_t     page_size   = SSC_getPageSize();
+  size_t     granularity = SSC_getAllocationGranularity();
+  size_t     delta, base_off, base_n;
+  uint8_t*   base;
+
+  if (size == 0 || (flags & SSC_MEMMAP_MAP_MIRRORED))
+    return -1;
+  if (flags & SSC_MEMMAP_MAP_HUGETLB) {
+    /* Files on hugetlbfs are always backed by huge pages, and must be mapped at huge page offsets. */
+    const size_t huge = hugetlbfsPageSize_(map->file);
+    if (huge)
+      page_size = granularity = huge;
+  }
+  /* Map from the nearest aligned file offset at or below @offset. */
+  delta    = offset % granularity;
+  base_off = offset - delta;
+  base_n   = size + delta;
+  /* Anonymous memory has no file offsets. */
+  if ((map->file == SSC_FILE_NULL_LITERAL) && (offset != 0))
+    return -1;
 #if    defined(SSC_OS_UNIXLIKE)
   const int rw = readonly ? PROT_READ : (PROT_READ|PROT_WRITE);
-  map->ptr = (uint8_t*)mmap(SSC_NULL, map->size, rw, MAP_SHARED, map->file, 0);
-  if (map->ptr == MAP_FAIL_) {
-    map->ptr = SSC_NULL;
-    return -1;
+  int mflags = (map->file == SSC_FILE_NULL_LITERAL) ? (MAP_PRIVATE|MAP_ANON_) : (cow ? MAP_PRIVATE : MAP_SHARED);
+ #ifdef MAP_POPULATE
+  /* MAP_POPULATE write-faults writable private file mappings, copying every page. */
+  if (prefault && !(cow && !readonly)) {
+    mflags |= MAP_POPULATE;
+    prefault = false; /* MAP_POPULATE already prefaults. */
   }
+ #endif
+  base = MAP_FAIL_;
+ #ifdef MAP_HUGETLB
+  if ((flags & SSC_MEMMAP_MAP_HUGETLB) && (map->file == SSC_FILE_NULL_LITERAL)) {
+    const size_t huge = defaultHugePageSize_();
+    if (huge) {
+      base = (uint8_t*)mmap(SSC_NULL, roundUp_(base_n, huge), rw, mflags|MAP_HUGETLB, -1, 0);
+      if (base != MAP_FAIL_)
+        page_size = huge;
+    }
+  }
+ #endif
+  if (base == MAP_FAIL_)
+    base = (uint8_t*)mmap(SSC_NULL, base_n, rw, mflags, map->file, (off_t)base_off);
+  if (base == MAP_FAIL_)
+    return -1;
 #elif  defined(SSC_OS_WINDOWS)
   Dw32_t high, low, page_rw, map_rw;
+  const uint64_t end = (uint64_t)offset + (uint64_t)size;
 
-  high = (Dw32_t)(((uint64_t)map->size & UINT64_C(0xffffffff00000000)) >> 32);
-  low  = (Dw32_t)(((uint64_t)map->size & UINT64_C(0x00000000ffffffff))      );
+  high = (Dw32_t)((end & UINT64_C(0xffffffff00000000)) >> 32);
+  low  = (Dw32_t)((end & UINT64_C(0x00000000ffffffff))      );
   if (readonly) {
     page_rw = PAGE_READONLY;
     map_rw  = FILE_MAP_READ;
   }
+  else if (cow) {
+    page_rw = PAGE_WRITECOPY;
+    map_rw  = FILE_MAP_COPY;
+  }
   else {
     page_rw = PAGE_READWRITE;
     map_rw  = (FILE_MAP_READ|FILE_MAP_WRITE);
   }
-  map->windows_filemap = CreateFileMappingA(map->file, SSC_NULL, page_rw, high, low, SSC_NULL);
+  /* Shared memory sections are created before mapping; otherwise create one now. */
+  if (map->windows_filemap == SSC_FILE_NULL_LITERAL) {
+    if ((flags & SSC_MEMMAP_MAP_HUGETLB) && (map->file == SSC_FILE_NULL_LITERAL)) {
+      /* Large pages are only available to pagefile-backed sections, and require SeLockMemoryPrivilege. */
+      const size_t large = (size_t)GetLargePageMinimum();
+      if (large) {
+        const uint64_t n = (uint64_t)roundUp_(base_n, large);
+        map->windows_filemap = CreateFileMappingA(
+         map->file, SSC_NULL, page_rw|SEC_COMMIT|SEC_LARGE_PAGES,
+         (Dw32_t)(n >> 32), (Dw32_t)(n & UINT64_C(0xffffffff)), SSC_NULL);
+        if (map->windows_filemap != SSC_NULL) {
+          map_rw |= FILE_MAP_LARGE_PAGES;
+          base_n = (size_t)n;
+          page_size = large;
+        }
+        else
+          map->windows_filemap = SSC_FILE_NULL_LITERAL;
+      }
+    }
+    if (map->windows_filemap == SSC_FILE_NULL_LITERAL)
+      map->windows_filemap = CreateFileMappingA(map->file, SSC_NULL, page_rw, high, low, SSC_NULL);
+    /* CreateFileMapping returns NULL on failure, not INVALID_HANDLE_VALUE. */
+    if (map->windows_filemap == SSC_NULL)
+      map->windows_filemap = SSC_FILE_NULL_LITERAL;
+  }
   if (map->windows_filemap == SSC_FILE_NULL_LITERAL)
     return -1;
-  map->ptr = (uint8_t*)MapViewOfFile(map->windows_filemap, map_rw, 0, 0, map->size);
-  if (map->ptr == MAP_FAIL_) {
+  high = (Dw32_t)(((uint64_t)base_off & UINT64_C(0xffffffff00000000)) >> 32);
+  low  = (Dw32_t)(((uint64_t)base_off & UINT64_C(0x00000000ffffffff))      );
+  base = (uint8_t*)MapViewOfFile(map->windows_filemap, map_rw, high, low, base_n);
+  if (base == MAP_FAIL_) {
     if (!SSC_File_close(map->windows_filemap))
       map->windows_filemap = SSC_FILE_NULL_LITERAL;
     return -1;
@@ -46,7 +192,20 @@ SSC_Error_t SSC_MemMap_map(SSC_MemMap* map, bool readonly)
 #else
  #error "Unsupported operating system."
 #endif
+  map->base = base;
+  map->ptr = base + delta;
+  map->size = size;
+  map->offset = offset;
+  map->page_size = page_size;
+  map->flags = flags;
   map->readonly = readonly;
+  /* Fall back to transparent huge pages when explicit huge pages weren't obtained. */
+  if ((flags & (SSC_MEMMAP_MAP_HUGEPAGE|SSC_MEMMAP_MAP_HUGETLB)) && (page_size == SSC_getPageSize()))
+    adviseHugePage_(map);
+  if (prefault && SSC_MemMap_prefault(map, 0, size)) {
+    SSC_MemMap_unmap(map);
+    return -1;
+  }
   return 0;
 }
 
@@ -54,17 +213,25 @@ SSC_Error_t SSC_MemMap_unmap(SSC_MemMap* map)
 {
   SSC_Error_t ret;
 #if defined(SSC_OS_UNIXLIKE)
-  ret = munmap(map->ptr, map->size);
+  /* Huge page mappings must be unmapped in whole huge pages. Mirrored maps are mapped twice. */
+  const size_t n = SSC_MemMap_baseSize(map) * ((map->flags & SSC_MEMMAP_MAP_MIRRORED) ? 2 : 1);
+  const size_t page_mask = map->page_size ? (map->page_size - 1) : 0;
+  ret = munmap(map->base, (n + page_mask) & ~page_mask);
   if (!ret) {
     map->ptr = SSC_NULL;
+    map->base = SSC_NULL;
     map->readonly = false;
   }
 #elif defined(SSC_OS_WINDOWS)
   ret = 0;
-  if (!UnmapViewOfFile((LPCVOID)map->ptr))
+  if ((map->flags & SSC_MEMMAP_MAP_MIRRORED) && !UnmapViewOfFile((LPCVOID)(map->base + map->size)))
     ret = -1;
-  else
+  if (!UnmapViewOfFile((LPCVOID)map->base))
+    ret = -1;
+  else {
     map->ptr = SSC_NULL;
+    map->base = SSC_NULL;
+  }
   if (SSC_File_close(map->windows_filemap))
     ret = -1;
   else
@@ -77,10 +244,537 @@ SSC_Error_t SSC_MemMap_unmap(SSC_MemMap* map)
   return ret;
 }
 
+SSC_Error_t SSC_MemMap_resize(SSC_MemMap* map, size_t size)
+{
+  const size_t old_size = map->size;
+  const bool   has_file = (map->file != SSC_FILE_NULL_LITERAL);
+  /* Readonly and private maps cannot change the size of their file; it must already be large enough. */
+  const bool   set_size = has_file && !map->readonly && !(map->flags & SSC_MEMMAP_MAP_PRIVATE);
+  size_t       old_file_size = 0;
+
+  if (size == 0 || (map->flags & SSC_MEMMAP_MAP_MIRRORED))
+    return -1;
+  if (size == old_size)
+    return 0;
+  if (set_size && SSC_File_getSize(map->file, &old_file_size))
+    return -1;
+#if defined(MREMAP_MAYMOVE)
+  /* Linux can grow or shrink the mapping in place, keeping its page tables;
+   * the mapping only moves when the adjacent address space is taken. */
+  if (map->page_size == SSC_getPageSize()) {
+    const size_t delta = (size_t)(map->ptr - map->base);
+    uint8_t* base;
+    if (set_size && (size > old_size) && SSC_File_setSize(map->file, map->offset + size))
+      return -1;
+    base = (uint8_t*)mremap(map->base, delta + old_size, delta + size, MREMAP_MAYMOVE);
+    if (base != MAP_FAIL_) {
+      map->base = base;
+      map->ptr = base + delta;
+      map->size = size;
+      if (set_size && (size < old_size) && SSC_File_setSize(map->file, map->offset + size))
+        return -1;
+      return 0;
+    }
+  }
+#endif
+  if (has_file) {
+    const SSC_BitFlag_t flags = map->flags;
+    /* Files of huge pages (e.g. on hugetlbfs) may only be sized in whole huge pages. */
+    const size_t page_mask = (map->page_size != SSC_getPageSize()) ? (map->page_size - 1) : 0;
+    /* Windows cannot change the size of a file with mapped views, so always unmap first. */
+    if (SSC_MemMap_unmap(map))
+      return -1;
+    if (!(set_size && SSC_File_setSize(map->file, map->offset + ((size + page_mask) & ~page_mask))) &&
+        !SSC_MemMap_mapRange(map, map->offset, size, flags))
+      return 0;
+    /* Restore the old size and mapping, so that a failed grow (e.g. a full disk) leaves @map usable. */
+    if (set_size)
+      SSC_File_setSize(map->file, old_file_size);
+    SSC_MemMap_mapRange(map, map->offset, old_size, flags);
+    return -1;
+  }
+#if defined(SSC_OS_WINDOWS)
+  /* Pagefile-backed sections cannot be resized, and may be shared. */
+  return -1;
+#else
+  /* Anonymous memory is moved into a new mapping. */
+  {
+    SSC_MemMap fresh = SSC_MEMMAP_NULL_LITERAL;
+    if (SSC_MemMap_mapRange(&fresh, 0, size, map->flags))
+      return -1;
+    memcpy(fresh.ptr, map->ptr, (size < old_size) ? size : old_size);
+    if (SSC_MemMap_unmap(map)) {
+      SSC_MemMap_unmap(&fresh);
+      return -1;
+    }
+    *map = fresh;
+    return 0;
+  }
+#endif
+}
+
+SSC_Error_t SSC_MemMap_reserve(SSC_MemMap* map, size_t size)
+{
+  size_t n = map->size;
+  if (size <= n)
+    return 0;
+  if (n == 0)
+    n = SSC_getPageSize();
+  /* Double until @size fits, so that a series of appends remaps O(log n) times. */
+  while (n < size) {
+    if (n > (SIZE_MAX / 2))
+      return SSC_MemMap_resize(map, size);
+    n *= 2;
+  }
+  return SSC_MemMap_resize(map, n);
+}
+
+/* Widen the @size bytes at (@map->ptr + @offset) outward to page boundaries,
+ * storing the first page at @addr and the number of bytes covered at @n. */
+static SSC_Error_t
+pageRange_(const SSC_MemMap* R_ map, size_t offset, size_t size, uint8_t** R_ addr, size_t* R_ n)
+{
+  const uintptr_t page_mask = (uintptr_t)SSC_getPageSize() - 1;
+  uintptr_t begin, end;
+
+  if (offset > map->size || size > (map->size - offset))
+    return -1;
+  begin = (uintptr_t)(map->ptr + offset);
+  end   = begin + size;
+  begin &= ~page_mask;
+  *addr = (uint8_t*)begin;
+  *n    = (size_t)(end - begin);
+  return 0;
+}
+
+#if   defined(SSC_OS_UNIXLIKE)
+ #if defined(MADV_NORMAL) && defined(MADV_SEQUENTIAL) && defined(MADV_RANDOM) &&\
+     defined(MADV_WILLNEED) && defined(MADV_DONTNEED)
+  #define ADVISE_(Addr, N, Advice) madvise(Addr, N, Advice)
+  #define ADV_NORMAL_     MADV_NORMAL
+  #define ADV_SEQUENTIAL_ MADV_SEQUENTIAL
+  #define ADV_RANDOM_     MADV_RANDOM
+  #define ADV_WILLNEED_   MADV_WILLNEED
+  #define ADV_DONTNEED_   MADV_DONTNEED
+ #else
+  #define ADVISE_(Addr, N, Advice) posix_madvise(Addr, N, Advice)
+  #define ADV_NORMAL_     POSIX_MADV_NORMAL
+  #define ADV_SEQUENTIAL_ POSIX_MADV_SEQUENTIAL
+  #define ADV_RANDOM_     POSIX_MADV_RANDOM
+  #define ADV_WILLNEED_   POSIX_MADV_WILLNEED
+  #define ADV_DONTNEED_   POSIX_MADV_DONTNEED
+ #endif
+#endif
+
+SSC_Error_t SSC_MemMap_adviseRange(const SSC_MemMap* map, size_t offset, size_t size, SSC_MemMapAdvice_t advice)
+{
+  uint8_t* addr;
+  size_t   n;
+
+  if (pageRange_(map, offset, size, &addr, &n))
+    return -1;
+  if (n == 0)
+    return 0;
+#if    defined(SSC_OS_UNIXLIKE)
+  int a;
+  switch (advice) {
+    case SSC_MEMMAP_ADVICE_NORMAL:     a = ADV_NORMAL_;     break;
+    case SSC_MEMMAP_ADVICE_SEQUENTIAL: a = ADV_SEQUENTIAL_; break;
+    case SSC_MEMMAP_ADVICE_RANDOM:     a = ADV_RANDOM_;     break;
+    case SSC_MEMMAP_ADVICE_WILLNEED:   a = ADV_WILLNEED_;   break;
+    case SSC_MEMMAP_ADVICE_DONTNEED:   a = ADV_DONTNEED_;   break;
+    default:
+      return -1;
+  }
+  return ADVISE_((void*)addr, n, a) ? -1 : 0;
+#elif  defined(SSC_OS_WINDOWS)
+  switch (advice) {
+    case SSC_MEMMAP_ADVICE_NORMAL:
+    case SSC_MEMMAP_ADVICE_SEQUENTIAL:
+    case SSC_MEMMAP_ADVICE_RANDOM:
+      return 0;
+    case SSC_MEMMAP_ADVICE_WILLNEED:
+    #if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+      {
+        WIN32_MEMORY_RANGE_ENTRY e;
+        e.VirtualAddress = (PVOID)addr;
+        e.NumberOfBytes  = (SIZE_T)n;
+        return PrefetchVirtualMemory(GetCurrentProcess(), 1, &e, 0) ? 0 : -1;
+      }
+    #else
+      return 0;
+    #endif
+    case SSC_MEMMAP_ADVICE_DONTNEED:
+      /* Unlocking pages that are not locked removes them from the working set. */
+      VirtualUnlock((LPVOID)addr, (SIZE_T)n);
+      return 0;
+    default:
+      return -1;
+  }
+#else
+ #error "Unsupported operating system."
+#endif
+}
+
+/* Populate the @n bytes at @addr of @map with MADV_POPULATE_READ/MADV_POPULATE_WRITE.
+ * Return false where that is unsupported. */
+static bool
+populate_(const SSC_MemMap* R_ map, uint8_t* R_ addr, size_t n)
+{
+#if defined(MADV_POPULATE_READ) && defined(MADV_POPULATE_WRITE)
+  /* Linux 5.14 and later can populate page tables directly. Older kernels reject these with EINVAL.
+   * Write-populating a file mapping would dirty every page, and allocate blocks for any holes,
+   * and a private mapping would be copied, so only anonymous memory is write-populated. */
+  const bool write = !map->readonly && (map->file == SSC_FILE_NULL_LITERAL);
+  return !madvise((void*)addr, n, write ? MADV_POPULATE_WRITE : MADV_POPULATE_READ);
+#else
+  (void)map;
+  (void)addr;
+  (void)n;
+  return false;
+#endif
+}
+
+/* Fault in the pages covering the @size bytes at @offset of @map by reading one byte of each. */
+static SSC_Error_t
+touch_(const SSC_MemMap* map, size_t offset, size_t size)
+{
+  const size_t page = SSC_getPageSize();
+  const volatile uint8_t* p;
+  uint8_t* addr;
+  size_t   n;
+
+  if (pageRange_(map, offset, size, &addr, &n))
+    return -1;
+  p = (const volatile uint8_t*)addr;
+  for (size_t i = 0; i < n; i += page)
+    (void)p[i];
+  return 0;
+}
+
+#define PREFETCH_CHUNK_ ((size_t)4 * 1024 * 1024) /* Bytes claimed by a prefetch thread at once. */
+
+/* State shared by the threads of one SSC_MemMap_prefetch() call. */
+typedef struct {
+  const SSC_MemMap* map;
+  size_t            offset;  /* The offset of the first byte to prefetch. */
+  size_t            size;    /* The number of bytes to prefetch. */
+  size_t            chunks;  /* The number of chunks @size is split into. */
+  volatile size_t   next;    /* The index of the next unclaimed chunk. */
+  volatile size_t   done;    /* The number of bytes prefetched. */
+  volatile size_t   failed;  /* Nonzero once any chunk failed. */
+  SSC_BitFlag_t     flags;
+  bool              populate; /* Try populate_() before touching each chunk. */
+} Prefetch_;
+
+/* Claim and prefetch one chunk of @pf. Return false when no chunks remain, or a chunk failed. */
+static bool
+prefetchChunk_(Prefetch_* pf)
+{
+  size_t i, off, n;
+  SSC_Error_t err;
+
+  if (SSC_atomicLoadSize(&pf->failed))
+    return false;
+  i = SSC_atomicFetchAddSize(&pf->next, 1);
+  if (i >= pf->chunks)
+    return false;
+  off = i * PREFETCH_CHUNK_;
+  n = ((pf->size - off) < PREFETCH_CHUNK_) ? (pf->size - off) : PREFETCH_CHUNK_;
+  if (pf->flags & SSC_MEMMAP_PREFETCH_TOUCH) {
+    uint8_t* addr;
+    size_t   pages;
+    err = pageRange_(pf->map, pf->offset + off, n, &addr, &pages);
+    if (!err && !(pf->populate && populate_(pf->map, addr, pages)))
+      err = touch_(pf->map, pf->offset + off, n);
+  } else
+    err = SSC_MemMap_adviseRange(pf->map, pf->offset + off, n, SSC_MEMMAP_ADVICE_WILLNEED);
+  if (err) {
+    SSC_atomicStoreSize(&pf->failed, 1);
+    return false;
+  }
+  SSC_atomicFetchAddSize(&pf->done, n);
+  return true;
+}
+
+static void
+prefetchThread_(void* arg)
+{
+  while (prefetchChunk_((Prefetch_*)arg))
+    ;
+}
+
+/* Implement SSC_MemMap_prefetch(). When @populate is false, touched chunks skip populate_(). */
+static SSC_Error_t
+prefetch_(
+ const SSC_MemMap* R_ map,
+ size_t               offset,
+ size_t               size,
+ unsigned             threads,
+ SSC_BitFlag_t        flags,
+ bool                 populate,
+ SSC_MemMapProgress_f progress,
+ void* R_             progress_arg)
+{
+  Prefetch_     pf;
+  SSC_Thread_t* workers = SSC_NULL;
+  unsigned      started = 0;
+  SSC_Error_t   ret = 0;
+
+  if (offset > map->size || size > (map->size - offset))
+    return -1;
+  if (size == 0)
+    return 0;
+  pf.map = map;
+  pf.offset = offset;
+  pf.size = size;
+  pf.chunks = (size / PREFETCH_CHUNK_) + ((size % PREFETCH_CHUNK_) ? 1 : 0);
+  pf.next = 0;
+  pf.done = 0;
+  pf.failed = 0;
+  pf.flags = flags;
+  pf.populate = populate;
+  if (threads == 0)
+    threads = SSC_getProcessorCount();
+  if (threads > pf.chunks)
+    threads = (unsigned)pf.chunks;
+  /* The calling thread is one of the @threads. If some fail to start, the rest do their share. */
+  if (threads > 1) {
+    workers = (SSC_Thread_t*)malloc((threads - 1) * sizeof(SSC_Thread_t));
+    if (workers) {
+      while (started < (threads - 1) && !SSC_Thread_create(workers + started, prefetchThread_, &pf))
+        ++started;
+    }
+  }
+  while (prefetchChunk_(&pf)) {
+    if (progress)
+      progress(SSC_atomicLoadSize(&pf.done), size, progress_arg);
+  }
+  for (unsigned i = 0; i < started; ++i) {
+    if (SSC_Thread_join(workers[i]))
+      ret = -1;
+  }
+  free(workers);
+  if (SSC_atomicLoadSize(&pf.failed))
+    return -1;
+  if (progress)
+    progress(size, size, progress_arg);
+  return ret;
+}
+
+SSC_Error_t SSC_MemMap_prefault(const SSC_MemMap* map, size_t offset, size_t size)
+{
+  uint8_t* addr;
+  size_t   n;
+
+  if (pageRange_(map, offset, size, &addr, &n))
+    return -1;
+  if (n == 0 || populate_(map, addr, n))
+    return 0;
+  /* Touching one page at a time waits on each read, so spread the pages over every processor. */
+  return prefetch_(map, offset, size, 0, SSC_MEMMAP_PREFETCH_TOUCH, false, SSC_NULL, SSC_NULL);
+}
+
+SSC_Error_t SSC_MemMap_prefetch(
+ const SSC_MemMap* R_ map,
+ size_t               offset,
+ size_t               size,
+ unsigned             threads,
+ SSC_BitFlag_t        flags,
+ SSC_MemMapProgress_f progress,
+ void* R_             progress_arg)
+{
+  return prefetch_(map, offset, size, threads, flags, true, progress, progress_arg);
+}
+
+#if   defined(SSC_OS_UNIXLIKE)
+ #if defined(__gnu_linux__)
+  typedef unsigned char MincoreVec_t;
+ #else
+  typedef char MincoreVec_t;
+ #endif
+ #define RESIDENCY_BATCH_ 4096 /* Pages queried per mincore() call. */
+#elif defined(SSC_OS_WINDOWS)
+ #include <psapi.h>
+ #define RESIDENCY_BATCH_ 512  /* Pages queried per QueryWorkingSetEx() call. */
+#endif
+
+SSC_Error_t SSC_MemMap_residency(
+ const SSC_MemMap* R_ map,
+ size_t               offset,
+ size_t               size,
+ size_t* R_           resident,
+ size_t* R_           total,
+ uint8_t* R_          bitmap)
+{
+  const size_t page = SSC_getPageSize();
+  uint8_t* addr;
+  size_t   n, pages, count = 0;
+
+  if (pageRange_(map, offset, size, &addr, &n))
+    return -1;
+  pages = (n + page - 1) / page;
+  if (bitmap)
+    memset(bitmap, 0, (pages + 7) / 8);
+  /* Query in fixed batches, so that huge maps need no heap allocation. */
+  for (size_t i = 0; i < pages; i += RESIDENCY_BATCH_) {
+    const size_t batch = ((pages - i) < RESIDENCY_BATCH_) ? (pages - i) : RESIDENCY_BATCH_;
+#if   defined(SSC_OS_UNIXLIKE)
+    MincoreVec_t vec[RESIDENCY_BATCH_];
+    if (mincore((void*)(addr + (i * page)), batch * page, vec))
+      return -1;
+    #define RESIDENT_(J) (vec[J] & 1)
+#elif defined(SSC_OS_WINDOWS)
+    PSAPI_WORKING_SET_EX_INFORMATION info[RESIDENCY_BATCH_];
+    for (size_t j = 0; j < batch; ++j)
+      info[j].VirtualAddress = (PVOID)(addr + ((i + j) * page));
+    if (!QueryWorkingSetEx(GetCurrentProcess(), info, (DWORD)(batch * sizeof(info[0]))))
+      return -1;
+    #define RESIDENT_(J) (info[J].VirtualAttributes.Valid)
+#else
+ #error "Unsupported operating system."
+#endif
+    for (size_t j = 0; j < batch; ++j) {
+      if (RESIDENT_(j)) {
+        ++count;
+        if (bitmap)
+          bitmap[(i + j) / 8] |= (uint8_t)(1u << ((i + j) % 8));
+      }
+    }
+    #undef RESIDENT_
+  }
+  if (resident)
+    *resident = count;
+  if (total)
+    *total = pages;
+  return 0;
+}
+
+SSC_Error_t SSC_MemMap_syncRange(const SSC_MemMap* map, size_t offset, size_t size, SSC_BitFlag_t flags)
+{
+  uint8_t* addr;
+  size_t   n;
+
+  if (pageRange_(map, offset, size, &addr, &n))
+    return -1;
+  if (n == 0)
+    return 0;
+#if   defined(SSC_OS_UNIXLIKE)
+  return msync((void*)addr, n, (flags & SSC_MEMMAP_SYNC_ASYNC) ? MS_ASYNC : MS_SYNC) ? -1 : 0;
+#elif defined(SSC_OS_WINDOWS)
+  /* FlushViewOfFile() only initiates writeback; FlushFileBuffers() waits for it. */
+  if (!FlushViewOfFile((LPCVOID)addr, n))
+    return -1;
+  if (!(flags & SSC_MEMMAP_SYNC_ASYNC) && (map->file != SSC_FILE_NULL_LITERAL) && !map->readonly &&
+      !(map->flags & SSC_MEMMAP_MAP_PRIVATE))
+    return FlushFileBuffers(map->file) ? 0 : -1;
+  return 0;
+#else
+ #error "Unsupported operating system."
+#endif
+}
+
+#define DIRTY_WORD_BITS_ 64
+
+SSC_Error_t SSC_MemMapDirty_init(SSC_MemMapDirty* dirty, size_t size, size_t chunk_size)
+{
+  size_t words;
+
+  *dirty = SSC_MEMMAPDIRTY_NULL_LITERAL;
+  if (chunk_size == 0)
+    chunk_size = SSC_getPageSize();
+  dirty->chunk_size = chunk_size;
+  dirty->chunk_count = (size / chunk_size) + ((size % chunk_size) ? 1 : 0);
+  words = (dirty->chunk_count / DIRTY_WORD_BITS_) + ((dirty->chunk_count % DIRTY_WORD_BITS_) ? 1 : 0);
+  if (words == 0)
+    return 0;
+  dirty->bits = (uint64_t*)calloc(words, sizeof(uint64_t));
+  if (dirty->bits == SSC_NULL) {
+    *dirty = SSC_MEMMAPDIRTY_NULL_LITERAL;
+    return -1;
+  }
+  return 0;
+}
+
+SSC_Error_t SSC_MemMapDirty_mark(SSC_MemMapDirty* dirty, size_t offset, size_t size)
+{
+  size_t first, last;
+
+  if (size == 0)
+    return 0;
+  first = offset / dirty->chunk_size;
+  last  = (offset + size - 1) / dirty->chunk_size;
+  if (offset + size < offset || last >= dirty->chunk_count)
+    return -1;
+  for (size_t i = first; i <= last; ++i)
+    dirty->bits[i / DIRTY_WORD_BITS_] |= (UINT64_C(1) << (i % DIRTY_WORD_BITS_));
+  return 0;
+}
+
+/* Is the chunk @i of @dirty marked? */
+static bool
+isDirty_(const SSC_MemMapDirty* dirty, size_t i)
+{
+  return (dirty->bits[i / DIRTY_WORD_BITS_] >> (i % DIRTY_WORD_BITS_)) & UINT64_C(1);
+}
+
+SSC_Error_t SSC_MemMapDirty_flush(SSC_MemMapDirty* R_ dirty, const SSC_MemMap* R_ map, SSC_BitFlag_t flags)
+{
+  size_t i = 0;
+
+  while (i < dirty->chunk_count) {
+    size_t begin, end, offset, size;
+    /* Skip clean words whole; most of a large map is usually clean. */
+    if (dirty->bits[i / DIRTY_WORD_BITS_] == 0) {
+      i = (i / DIRTY_WORD_BITS_ + 1) * DIRTY_WORD_BITS_;
+      continue;
+    }
+    if (!isDirty_(dirty, i)) {
+      ++i;
+      continue;
+    }
+    /* Coalesce the run of dirty chunks beginning at @i into one sync. */
+    begin = i;
+    do {
+      ++i;
+    } while (i < dirty->chunk_count && isDirty_(dirty, i));
+    end = i;
+    offset = begin * dirty->chunk_size;
+    if (offset >= map->size)
+      size = 0;
+    else {
+      size = (end - begin) * dirty->chunk_size;
+      if (size > map->size - offset)
+        size = map->size - offset;
+    }
+    /* Chunks remain marked unless they were flushed, so a failed flush may be retried. */
+    if (size && SSC_MemMap_syncRange(map, offset, size, flags))
+      return -1;
+    for (size_t j = begin; j < end; ++j)
+      dirty->bits[j / DIRTY_WORD_BITS_] &= ~(UINT64_C(1) << (j % DIRTY_WORD_BITS_));
+  }
+  return 0;
+}
+
+void SSC_MemMapDirty_del(SSC_MemMapDirty* dirty)
+{
+  free(dirty->bits);
+  *dirty = SSC_MEMMAPDIRTY_NULL_LITERAL;
+}
+
 #define RONLY_       SSC_MEMMAP_INIT_READONLY
 #define ALLOWSHRINK_ SSC_MEMMAP_INIT_ALLOWSHRINK
 #define FEXIST_      SSC_MEMMAP_INIT_FORCE_EXIST
 #define FEXIST_Y_    SSC_MEMMAP_INIT_FORCE_EXIST_YES
+#define SEQUENTIAL_  SSC_MEMMAP_INIT_ADVISE_SEQUENTIAL
+#define RANDOM_      SSC_MEMMAP_INIT_ADVISE_RANDOM
+#define WILLNEED_    SSC_MEMMAP_INIT_ADVISE_WILLNEED
+#define DONTNEED_    SSC_MEMMAP_INIT_ADVISE_DONTNEED
+#define PREFAULT_    SSC_MEMMAP_INIT_PREFAULT
+#define HUGEPAGE_    SSC_MEMMAP_INIT_HUGEPAGE
+#define HUGETLB_     SSC_MEMMAP_INIT_HUGETLB
+#define PRIVATE_     SSC_MEMMAP_INIT_PRIVATE
+#define SEALABLE_    SSC_MEMMAP_INIT_SEALABLE
 
 #define OK_                  SSC_MEMMAP_INIT_CODE_OK
 #define ERR_FEXIST_NO_       SSC_MEMMAP_INIT_CODE_ERR_FEXIST_NO
@@ -93,6 +787,87 @@ SSC_Error_t SSC_MemMap_unmap(SSC_MemMap* map)
 #define ERR_GET_FILE_SIZE_   SSC_MEMMAP_INIT_CODE_ERR_GET_FILE_SIZE
 #define ERR_SET_FILE_SIZE_   SSC_MEMMAP_INIT_CODE_ERR_SET_FILE_SIZE
 #define ERR_MAP_             SSC_MEMMAP_INIT_CODE_ERR_MAP
+#define ERR_ADVISE_          SSC_MEMMAP_INIT_CODE_ERR_ADVISE
+#define ERR_SEALS_           SSC_MEMMAP_INIT_CODE_ERR_SEALS
+
+/* Map all @map->size bytes of @map->file (or anonymous memory), according to the init flags @flags. */
+static SSC_CodeError_t
+mapInit_(SSC_MemMap* map, bool readonly, SSC_BitFlag_t flags)
+{
+  SSC_BitFlag_t mflags = readonly ? SSC_MEMMAP_MAP_READONLY : 0;
+  if (flags & PREFAULT_)
+    mflags |= SSC_MEMMAP_MAP_PREFAULT;
+  if (flags & HUGEPAGE_)
+    mflags |= SSC_MEMMAP_MAP_HUGEPAGE;
+  if (flags & HUGETLB_)
+    mflags |= SSC_MEMMAP_MAP_HUGETLB;
+  if (flags & PRIVATE_)
+    mflags |= SSC_MEMMAP_MAP_PRIVATE;
+  if (SSC_MemMap_mapRange(map, 0, map->size, mflags))
+    return ERR_MAP_;
+  /* Apply any access pattern advice. */
+  if ((flags & SEQUENTIAL_) && SSC_MemMap_advise(map, SSC_MEMMAP_ADVICE_SEQUENTIAL))
+    return ERR_ADVISE_;
+  if ((flags & RANDOM_) && SSC_MemMap_advise(map, SSC_MEMMAP_ADVICE_RANDOM))
+    return ERR_ADVISE_;
+  if ((flags & WILLNEED_) && SSC_MemMap_advise(map, SSC_MEMMAP_ADVICE_WILLNEED))
+    return ERR_ADVISE_;
+  if ((flags & DONTNEED_) && SSC_MemMap_advise(map, SSC_MEMMAP_ADVICE_DONTNEED))
+    return ERR_ADVISE_;
+  return OK_;
+}
+
+/* Terminate the program, describing the SSC_MemMap_init* failure @ce of @name in @func.
+ * Return if @ce is OK_. */
+static void
+initDie_(SSC_CodeError_t ce, const char* R_ name, const char* R_ func)
+{
+  const char* err_str;
+  switch (ce) {
+    case OK_:
+      return;
+    case ERR_FEXIST_NO_:
+      SSC_errx("Error:%s: Filepath ``%s'' exists, when it shouldn't!\n", func, name);
+      break;
+    case ERR_FEXIST_YES_:
+      SSC_errx("Error:%s: Filepath ``%s'' does not exist, when it should!\n", func, name);
+      break;
+    case ERR_READONLY_:
+      err_str = "File creation prevented by readonly";
+      break;
+    case ERR_SHRINK_:
+      err_str = "File shrinking disallowed";
+      break;
+    case ERR_NOSIZE_:
+      err_str = "Size not provided for new filepath";
+      break;
+    case ERR_OPEN_FILEPATH_:
+      err_str = "SSC_Filepath_open failed";
+      break;
+    case ERR_CREATE_FILEPATH_:
+      err_str = "SSC_FilePath_create failed";
+      break;
+    case ERR_GET_FILE_SIZE_:
+      err_str = "SSC_File_getSize failed";
+      break;
+    case ERR_SET_FILE_SIZE_:
+      err_str = "SSC_File_setSize failed";
+      break;
+    case ERR_MAP_:
+      err_str = "SSC_MemMap_map failed";
+      break;
+    case ERR_ADVISE_:
+      err_str = "SSC_MemMap_advise failed";
+      break;
+    case ERR_SEALS_:
+      err_str = "Memory not sealed";
+      break;
+    default:
+      err_str = "Invalid SSC_CodeError_t";
+      break;
+  }
+  SSC_errx("Error: %s in function %s!\n", err_str, func);
+}
 
 SSC_CodeError_t SSC_MemMap_init(
  SSC_MemMap* R_ map,
@@ -100,33 +875,46 @@ SSC_CodeError_t SSC_MemMap_init(
  size_t         size,
  SSC_BitFlag_t  flags)
 {
-  bool exists, readonly, allowshrink, setsize;
+  SSC_BitFlag_t oflags = 0;
+  bool created, readonly, allowshrink, setsize, must_exist;
 
-  exists = SSC_FilePath_exists(filepath);
-  readonly = exists && (flags & RONLY_);
+  /* Callers needn't initialize @map; in particular, no section may be left for mapRange to reuse. */
+  *map = SSC_MEMMAP_NULL_LITERAL;
+  /* Copy-on-write maps never write back, so there is nothing to create or resize. */
+  must_exist = (flags & PRIVATE_) || ((flags & FEXIST_) && (flags & FEXIST_Y_));
+  readonly = (flags & (RONLY_|PRIVATE_));
   allowshrink = (flags & ALLOWSHRINK_);
-  /* We will set the size when the filepath
-   * doesn't exist, and when it does exist and a size has been requested. */
-  setsize = !readonly && (!exists || (size > 0));
-  if (flags & FEXIST_) {
-    if (flags & FEXIST_Y_) {
-    /* We are forcing existence. */
-      if (!exists)
-        return ERR_FEXIST_YES_;
-    }
-    else {
+  if (readonly)
+    oflags |= SSC_FILEPATH_OPEN_READONLY;
+  if ((flags & FEXIST_) && !(flags & FEXIST_Y_)) {
     /* We are forcing non-existence. */
-      if (exists)
-        return ERR_FEXIST_NO_;
-    }
+    if (size == 0)
+      return SSC_FilePath_exists(filepath) ? ERR_FEXIST_NO_ : ERR_NOSIZE_;
+    oflags |= (SSC_FILEPATH_OPEN_CREATE|SSC_FILEPATH_OPEN_EXCLUSIVE);
   }
-  /* Does the file exist? */
-
-  /* It does exist. */
-  if (exists) {
-    /* It does. Open it and store the SSC_File_t in @map. */
-    if (SSC_FilePath_open(filepath, readonly, &map->file))
+  else if (!must_exist && (size > 0))
+    oflags |= SSC_FILEPATH_OPEN_CREATE;
+  /* Let the open decide whether the file exists, rather than asking first. */
+  switch (SSC_FilePath_openOrCreate(filepath, oflags, &map->file, &created)) {
+    case SSC_FILEPATH_OPEN_CODE_OK:
+      break;
+    case SSC_FILEPATH_OPEN_CODE_ERR_NOEXIST:
+      /* Since it didn't exist a size must be provided by the caller. */
+      return must_exist ? ERR_FEXIST_YES_ : ERR_NOSIZE_;
+    case SSC_FILEPATH_OPEN_CODE_ERR_EXIST:
+      return ERR_FEXIST_NO_;
+    case SSC_FILEPATH_OPEN_CODE_ERR_CREATE:
+      return ERR_CREATE_FILEPATH_;
+    default:
       return ERR_OPEN_FILEPATH_;
+  }
+  /* When we create a new file, it's implicitly readwrite, not readonly. */
+  if (created)
+    readonly = false;
+  /* We will set the size when the file was created,
+   * and when it already existed and a size has been requested. */
+  setsize = !readonly && (created || (size > 0));
+  if (!created) {
     /* Store the size of the file in @map->size. */
     if (SSC_File_getSize(map->file, &map->size))
       return ERR_GET_FILE_SIZE_;
@@ -143,28 +931,13 @@ SSC_CodeError_t SSC_MemMap_init(
         setsize = false; /* ... no size change is necessary. */
     }
   }
-  /* The file didn't exist. */
-  else {
-    /* Since it didn't exist requesting readonly makes no sense. */
-    if (readonly)
-      return ERR_READONLY_;
-    /* Since it didn't exist a size must be provided by the caller. */
-    if (size == 0)
-      return ERR_NOSIZE_;
-    /* Create the file at the @filepath and store the SSC_File_t in @map. */
-    if (SSC_FilePath_create(filepath, &map->file))
-      return ERR_CREATE_FILEPATH_;
-  }
   if (setsize) {
     /* Set the size according to that specified by the caller. */
     map->size = size;
     if (SSC_File_setSize(map->file, map->size))
       return ERR_SET_FILE_SIZE_;
   }
-  /* When we create a new file, it's implicitly readwrite, not readonly. */
-  if (SSC_MemMap_map(map, readonly))
-    return ERR_MAP_;
-  return OK_;
+  return mapInit_(map, readonly && (flags & RONLY_), flags);
 }
 
 void SSC_MemMap_initOrDie(
@@ -173,46 +946,304 @@ void SSC_MemMap_initOrDie(
  size_t          size,
  SSC_BitFlag_t   flags)
 {
-  SSC_CodeError_t ce = SSC_MemMap_init(map, filepath, size, flags);
-  const char* err_str;
-  switch (ce) {
-    case OK_:
-      return;
-    case ERR_FEXIST_NO_:
-      SSC_errx("Error:SSC_MemMap_initOrDie: Filepath ``%s'' exists, when it shouldn't!\n", filepath);
-      break;
-    case ERR_FEXIST_YES_:
-      SSC_errx("Error:SSC_MemMap_initOrDie: Filepath ``%s'' does not exist, when it should!\n", filepath);
-      break;
-    case ERR_READONLY_:
-      err_str = "File creation prevented by readonly";
-      break;
-    case ERR_SHRINK_:
-      err_str = "File shrinking disallowed";
-      break;
-    case ERR_NOSIZE_:
-      err_str = "Size not provided for new filepath";
-      break;
-    case ERR_OPEN_FILEPATH_:
-      err_str = "SSC_Filepath_open failed";
-      break;
-    case ERR_CREATE_FILEPATH_:
-      err_str = "SSC_FilePath_create failed";
-      break;
-    case ERR_GET_FILE_SIZE_:
-      err_str = "SSC_File_getSize failed";
-      break;
-    case ERR_SET_FILE_SIZE_:
-      err_str = "SSC_File_setSize failed";
-      break;
-    case ERR_MAP_:
-      err_str = "SSC_MemMap_map failed";
+  initDie_(SSC_MemMap_init(map, filepath, size, flags), filepath, "SSC_MemMap_initOrDie");
+}
+
+SSC_CodeError_t SSC_MemMap_initAnonymous(
+ SSC_MemMap*   map,
+ size_t        size,
+ SSC_BitFlag_t flags)
+{
+  *map = SSC_MEMMAP_NULL_LITERAL;
+  if (size == 0)
+    return ERR_NOSIZE_;
+  map->size = size;
+  return mapInit_(map, false, flags);
+}
+
+void SSC_MemMap_initAnonymousOrDie(
+ SSC_MemMap*   map,
+ size_t        size,
+ SSC_BitFlag_t flags)
+{
+  initDie_(SSC_MemMap_initAnonymous(map, size, flags), "(anonymous)", "SSC_MemMap_initAnonymousOrDie");
+}
+
+#if defined(SSC_OS_UNIXLIKE)
+/* Create a shared memory object that has no name, so it is freed
+ * once every descriptor and mapping referring to it is gone.
+ * When @sealable is true, allow seals to be added to it where possible. */
+static SSC_File_t
+anonymousShm_(bool sealable)
+{
+ #if   defined(MFD_CLOEXEC)
+  unsigned mfd_flags = MFD_CLOEXEC;
+  #ifdef MFD_ALLOW_SEALING
+  if (sealable)
+    mfd_flags |= MFD_ALLOW_SEALING;
+  #endif
+  return memfd_create("SSC_MemMap", mfd_flags);
+ #elif defined(SHM_ANON)
+  (void)sealable;
+  return shm_open(SHM_ANON, O_RDWR, (mode_t)0600);
+ #else
+  (void)sealable;
+  /* Create a uniquely named object, then immediately unlink the name. */
+  char    name[32];
+  uint8_t rnd[8];
+  for (int tries = 0; tries < 16; ++tries) {
+    SSC_File_t f;
+    SSC_getEntropy(rnd, sizeof(rnd));
+    snprintf(name, sizeof(name), "/SSC_%016" PRIx64, SSC_loadLittleEndian64(rnd));
+    f = shm_open(name, O_RDWR|O_CREAT|O_EXCL, (mode_t)0600);
+    if (f != SSC_FILE_NULL_LITERAL) {
+      shm_unlink(name);
+      return f;
+    }
+    if (errno != EEXIST)
       break;
-    default:
-      err_str = "Invalid SSC_CodeError_t";
+  }
+  return SSC_FILE_NULL_LITERAL;
+ #endif
+}
+#endif
+
+SSC_CodeError_t SSC_MemMap_initShared(
+ SSC_MemMap* R_ map,
+ const char* R_ name,
+ size_t         size,
+ SSC_BitFlag_t  flags)
+{
+  bool readonly = false;
+  size_t cur_size;
+
+  *map = SSC_MEMMAP_NULL_LITERAL;
+#if    defined(SSC_OS_UNIXLIKE)
+  if (name) {
+    int oflags;
+    readonly = (flags & RONLY_);
+    if (readonly)
+      oflags = O_RDONLY; /* Only existing objects may be opened readonly. */
+    else if ((flags & FEXIST_) && (flags & FEXIST_Y_))
+      oflags = O_RDWR;
+    else if (flags & FEXIST_)
+      oflags = O_RDWR|O_CREAT|O_EXCL;
+    else
+      oflags = O_RDWR|O_CREAT;
+    map->file = shm_open(name, oflags, (mode_t)0600);
+    if (map->file == SSC_FILE_NULL_LITERAL) {
+      if (errno == EEXIST)
+        return ERR_FEXIST_NO_;
+      if (errno == ENOENT)
+        return readonly ? ERR_READONLY_ : ERR_FEXIST_YES_;
+      return ERR_OPEN_FILEPATH_;
+    }
+  }
+  else {
+    if ((map->file = anonymousShm_(flags & SEALABLE_)) == SSC_FILE_NULL_LITERAL)
+      return ERR_CREATE_FILEPATH_;
+  }
+  if (SSC_File_getSize(map->file, &cur_size))
+    return ERR_GET_FILE_SIZE_;
+  if (size > 0 && size != cur_size) {
+    if (readonly)
+      return ERR_READONLY_;
+    if (size < cur_size && !(flags & ALLOWSHRINK_))
+      return ERR_SHRINK_;
+    if (SSC_File_setSize(map->file, size))
+      return ERR_SET_FILE_SIZE_;
+    cur_size = size;
+  }
+#elif  defined(SSC_OS_WINDOWS)
+  if (name && ((flags & RONLY_) || size == 0 || ((flags & FEXIST_) && (flags & FEXIST_Y_)))) {
+    /* Open an existing section. */
+    MEMORY_BASIC_INFORMATION mbi;
+    void* view;
+    readonly = (flags & RONLY_);
+    map->windows_filemap = OpenFileMappingA(readonly ? FILE_MAP_READ : (FILE_MAP_READ|FILE_MAP_WRITE), FALSE, name);
+    if (map->windows_filemap == SSC_NULL) {
+      map->windows_filemap = SSC_FILE_NULL_LITERAL;
+      return (GetLastError() == ERROR_FILE_NOT_FOUND) ? ERR_FEXIST_YES_ : ERR_OPEN_FILEPATH_;
+    }
+    /* Sections don't expose their size; measure a view of the whole section. */
+    view = MapViewOfFile(map->windows_filemap, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+      return ERR_GET_FILE_SIZE_;
+    if (!VirtualQuery(view, &mbi, sizeof(mbi))) {
+      UnmapViewOfFile(view);
+      return ERR_GET_FILE_SIZE_;
+    }
+    UnmapViewOfFile(view);
+    cur_size = (size_t)mbi.RegionSize;
+    if (size > cur_size)
+      return ERR_SET_FILE_SIZE_; /* Sections cannot be resized. */
+    if (size > 0)
+      cur_size = size;
+  }
+  else {
+    if (size == 0)
+      return ERR_NOSIZE_;
+    map->windows_filemap = CreateFileMappingA(
+     INVALID_HANDLE_VALUE, SSC_NULL, PAGE_READWRITE,
+     (Dw32_t)((uint64_t)size >> 32), (Dw32_t)((uint64_t)size & UINT64_C(0xffffffff)), name);
+    if (map->windows_filemap == SSC_NULL) {
+      map->windows_filemap = SSC_FILE_NULL_LITERAL;
+      return ERR_CREATE_FILEPATH_;
+    }
+    if (name && (GetLastError() == ERROR_ALREADY_EXISTS) && (flags & FEXIST_)) {
+      SSC_File_close(map->windows_filemap);
+      map->windows_filemap = SSC_FILE_NULL_LITERAL;
+      return ERR_FEXIST_NO_;
+    }
+    cur_size = size;
+  }
+#else
+ #error "Unsupported operating system."
+#endif
+  if (cur_size == 0)
+    return ERR_NOSIZE_;
+  map->size = cur_size;
+  return mapInit_(map, readonly, flags);
+}
+
+void SSC_MemMap_initSharedOrDie(
+ SSC_MemMap* R_ map,
+ const char* R_ name,
+ size_t         size,
+ SSC_BitFlag_t  flags)
+{
+  initDie_(SSC_MemMap_initShared(map, name, size, flags), name ? name : "(anonymous)", "SSC_MemMap_initSharedOrDie");
+}
+
+SSC_Error_t SSC_MemMap_unlinkShared(const char* name)
+{
+#if    defined(SSC_OS_UNIXLIKE)
+  return shm_unlink(name) ? -1 : 0;
+#elif  defined(SSC_OS_WINDOWS)
+  /* Named sections are destroyed with the last handle referring to them. */
+  (void)name;
+  return 0;
+#else
+ #error "Unsupported operating system."
+#endif
+}
+
+#if defined(SSC_OS_UNIXLIKE) && defined(F_ADD_SEALS)
+ #define SEALS_ (F_SEAL_WRITE|F_SEAL_SHRINK|F_SEAL_GROW)
+#endif
+
+SSC_Error_t SSC_MemMap_seal(SSC_MemMap* map)
+{
+#if defined(SSC_OS_UNIXLIKE) && defined(F_ADD_SEALS)
+  const size_t        offset = map->offset;
+  const size_t        size   = map->size;
+  const SSC_BitFlag_t flags  = map->flags;
+  const bool          remap  = (map->ptr != SSC_NULL) && !map->readonly;
+  int ret;
+
+  if ((map->file == SSC_FILE_NULL_LITERAL) || (flags & SSC_MEMMAP_MAP_MIRRORED))
+    return -1;
+  /* Writes can't be sealed while a writable shared mapping exists, including our own. */
+  if (remap && SSC_MemMap_unmap(map))
+    return -1;
+  ret = fcntl(map->file, F_ADD_SEALS, SEALS_|F_SEAL_SEAL);
+  if (remap && SSC_MemMap_mapRange(map, offset, size, ret ? flags : (flags|SSC_MEMMAP_MAP_READONLY)))
+    return -1;
+  return ret ? -1 : 0;
+#else
+  /* There is no way to seal memory here. */
+  (void)map;
+  return -1;
+#endif
+}
+
+SSC_CodeError_t SSC_MemMap_initSealed(SSC_MemMap* map, SSC_File_t file, SSC_BitFlag_t flags)
+{
+  *map = SSC_MEMMAP_NULL_LITERAL;
+  map->file = file;
+#if defined(SSC_OS_UNIXLIKE) && defined(F_GET_SEALS)
+  {
+    const int seals = fcntl(file, F_GET_SEALS);
+    if ((seals == -1) || ((seals & SEALS_) != SEALS_))
+      return ERR_SEALS_;
+  }
+  if (SSC_File_getSize(file, &map->size))
+    return ERR_GET_FILE_SIZE_;
+  if (map->size == 0)
+    return ERR_NOSIZE_;
+  return mapInit_(map, true, flags & ~PRIVATE_);
+#else
+  (void)flags;
+  return ERR_SEALS_;
+#endif
+}
+
+SSC_Error_t SSC_MemMap_initMirrored(SSC_MemMap* map, size_t size)
+{
+  const size_t granularity = SSC_getAllocationGranularity();
+  uint8_t* base;
+
+  *map = SSC_MEMMAP_NULL_LITERAL;
+  if (size == 0 || size > (SIZE_MAX / 4))
+    return -1;
+  size = roundUp_(size, granularity);
+#if    defined(SSC_OS_UNIXLIKE)
+  if ((map->file = anonymousShm_(false)) == SSC_FILE_NULL_LITERAL)
+    return -1;
+  if (SSC_File_setSize(map->file, size)) {
+    SSC_MemMap_del(map);
+    return -1;
+  }
+  /* Reserve the address space for both halves, then replace it with the two views. */
+  base = (uint8_t*)mmap(SSC_NULL, size * 2, PROT_NONE, MAP_PRIVATE|MAP_ANON_, -1, 0);
+  if (base == MAP_FAIL_) {
+    SSC_MemMap_del(map);
+    return -1;
+  }
+  if ((mmap(base, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, map->file, 0) == MAP_FAILED) ||
+      (mmap(base + size, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, map->file, 0) == MAP_FAILED))
+  {
+    munmap(base, size * 2);
+    SSC_MemMap_del(map);
+    return -1;
+  }
+#elif  defined(SSC_OS_WINDOWS)
+  map->windows_filemap = CreateFileMappingA(
+   INVALID_HANDLE_VALUE, SSC_NULL, PAGE_READWRITE,
+   (Dw32_t)((uint64_t)size >> 32), (Dw32_t)((uint64_t)size & UINT64_C(0xffffffff)), SSC_NULL);
+  if (map->windows_filemap == SSC_NULL) {
+    map->windows_filemap = SSC_FILE_NULL_LITERAL;
+    return -1;
+  }
+  base = MAP_FAIL_;
+  /* Find a free region for both halves, release it, and map the views into it. Another thread
+   * may claim the region in between, so try again a few times. */
+  for (int tries = 0; (tries < 16) && (base == MAP_FAIL_); ++tries) {
+    uint8_t* region = (uint8_t*)VirtualAlloc(SSC_NULL, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+    if (!region)
       break;
+    VirtualFree(region, 0, MEM_RELEASE);
+    base = (uint8_t*)MapViewOfFileEx(map->windows_filemap, FILE_MAP_READ|FILE_MAP_WRITE, 0, 0, size, region);
+    if (base == MAP_FAIL_)
+      continue;
+    if (!MapViewOfFileEx(map->windows_filemap, FILE_MAP_READ|FILE_MAP_WRITE, 0, 0, size, region + size)) {
+      UnmapViewOfFile(base);
+      base = MAP_FAIL_;
+    }
   }
-  SSC_errx(SSC_ERR_S_IN(err_str));
+  if (base == MAP_FAIL_) {
+    SSC_MemMap_del(map);
+    return -1;
+  }
+#else
+ #error "Unsupported operating system."
+#endif
+  map->ptr = base;
+  map->base = base;
+  map->size = size;
+  map->page_size = SSC_getPageSize();
+  map->flags = SSC_MEMMAP_MAP_MIRRORED;
+  return 0;
 }
 
 void SSC_MemMap_del(SSC_MemMap* map)
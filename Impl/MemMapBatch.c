@@ -0,0 +1,95 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "MemMapBatch.h"
+#define R_ SSC_RESTRICT
+
+/* Ensure @batch->pack has room for @n more bytes, growing it geometrically. */
+static SSC_Error_t
+reservePack_(SSC_MemMapBatch* batch, size_t* R_ capacity, size_t n)
+{
+  size_t c = *capacity;
+  uint8_t* p;
+  if (n <= (c - batch->pack_size))
+    return 0;
+  if (c == 0)
+    c = 4096;
+  while (n > (c - batch->pack_size))
+    c *= 2;
+  p = (uint8_t*)realloc(batch->pack, c);
+  if (!p)
+    return -1;
+  batch->pack = p;
+  *capacity = c;
+  return 0;
+}
+
+SSC_Error_t SSC_MemMapBatch_init(
+ SSC_MemMapBatch* R_      batch,
+ const char* const* R_    paths,
+ size_t                   count,
+ size_t                   pack_max,
+ SSC_BitFlag_t            flags)
+{
+  size_t pack_capacity = 0;
+
+  *batch = SSC_MEMMAPBATCH_NULL_LITERAL;
+  if (count == 0)
+    return 0;
+  batch->files = (SSC_MemMapBatchFile*)malloc(count * sizeof(SSC_MemMapBatchFile));
+  if (!batch->files)
+    return -1;
+  batch->count = count;
+  for (size_t i = 0; i < count; ++i) {
+    SSC_MemMapBatchFile* f = batch->files + i;
+    SSC_File_t file;
+    f->ptr = SSC_NULL;
+    f->size = 0;
+    f->map = SSC_MEMMAP_NULL_LITERAL;
+    f->ok = false;
+    /* Opening fails for missing files anyway; probing for them first would cost more syscalls. */
+    if (SSC_FilePath_open(paths[i], true, &file) || SSC_File_getSize(file, &f->size)) {
+      if (file != SSC_FILE_NULL_LITERAL)
+        SSC_File_close(file);
+      ++batch->failed;
+      continue;
+    }
+    if (f->size <= pack_max || f->size == 0) {
+      /* Record the offset for now, since @batch->pack may move as it grows. */
+      if (!reservePack_(batch, &pack_capacity, f->size) &&
+          !SSC_File_readAt(file, batch->pack + batch->pack_size, f->size, 0, SSC_NULL))
+      {
+        f->ptr = (const uint8_t*)(uintptr_t)batch->pack_size;
+        batch->pack_size += f->size;
+        f->ok = true;
+      }
+    }
+    else {
+      f->map.file = file;
+      f->map.size = f->size;
+      if (!SSC_MemMap_mapRange(&f->map, 0, f->size, flags | SSC_MEMMAP_MAP_READONLY)) {
+        f->ptr = f->map.ptr;
+        f->ok = true;
+      }
+      f->map.file = SSC_FILE_NULL_LITERAL; /* The mapping keeps the file alive by itself. */
+    }
+    SSC_File_close(file);
+    if (!f->ok)
+      ++batch->failed;
+  }
+  /* Turn the recorded offsets into pointers into the final pack buffer. */
+  for (size_t i = 0; i < count; ++i) {
+    SSC_MemMapBatchFile* f = batch->files + i;
+    if (f->ok && !f->map.ptr)
+      f->ptr = batch->pack ? (batch->pack + (uintptr_t)f->ptr) : SSC_NULL;
+  }
+  return 0;
+}
+
+void SSC_MemMapBatch_del(SSC_MemMapBatch* batch)
+{
+  for (size_t i = 0; i < batch->count; ++i)
+    SSC_MemMap_del(&batch->files[i].map);
+  free(batch->files);
+  free(batch->pack);
+  *batch = SSC_MEMMAPBATCH_NULL_LITERAL;
+}
@@ -0,0 +1,102 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "MemMapStream.h"
+#define R_ SSC_RESTRICT
+
+#if   defined(SSC_OS_UNIXLIKE)
+ #if   defined(POSIX_FADV_WILLNEED)
+  #define READAHEAD_IMPL_(File, Offset, Size) {\
+   posix_fadvise(File, (off_t)Offset, (off_t)Size, POSIX_FADV_WILLNEED);\
+  }
+ #elif defined(F_RDADVISE)
+  #include <limits.h>
+  #define READAHEAD_IMPL_(File, Offset, Size) {\
+   struct radvisory ra;\
+   ra.ra_offset = (off_t)Offset;\
+   ra.ra_count  = (Size > INT_MAX) ? INT_MAX : (int)Size;\
+   fcntl(File, F_RDADVISE, &ra);\
+  }
+ #else
+  #define READAHEAD_IMPL_(File_, Offset_, Size_) { /* Nil */ }
+ #endif
+#elif defined(SSC_OS_WINDOWS)
+ /* The Windows cache manager detects sequential access and reads ahead on its own. */
+ #define READAHEAD_IMPL_(File_, Offset_, Size_) { /* Nil */ }
+#else
+ #error "Unsupported operating system."
+#endif
+
+/* Advise the OS that @size bytes of @file beginning at @offset will be needed soon.
+ * This is only a hint, so failure is ignored. */
+static void
+readAhead_(SSC_File_t file, size_t offset, size_t size)
+READAHEAD_IMPL_(file, offset, size)
+
+SSC_Error_t
+SSC_MemMapStream_init(
+ SSC_MemMapStream* R_ stream,
+ const char* R_       filepath,
+ size_t               window,
+ size_t               overlap,
+ bool                 readonly)
+{
+  *stream = SSC_MEMMAPSTREAM_NULL_LITERAL;
+  if (window == 0 || overlap >= window)
+    return -1;
+  if (SSC_FilePath_open(filepath, readonly, &stream->map.file))
+    return -1;
+  if (SSC_File_getSize(stream->map.file, &stream->file_size)) {
+    SSC_File_close(stream->map.file);
+    stream->map.file = SSC_FILE_NULL_LITERAL;
+    return -1;
+  }
+  stream->window = window;
+  stream->overlap = overlap;
+  stream->flags = readonly ? SSC_MEMMAP_MAP_READONLY : 0;
+  readAhead_(stream->map.file, 0, window);
+  return 0;
+}
+
+SSC_CodeError_t
+SSC_MemMapStream_next(SSC_MemMapStream* stream)
+{
+  size_t size, end;
+
+  if (stream->map.ptr && SSC_MemMap_unmap(&stream->map))
+    return SSC_MEMMAPSTREAM_CODE_ERR_UNMAP;
+  if (stream->next >= stream->file_size)
+    return SSC_MEMMAPSTREAM_CODE_END;
+  size = stream->file_size - stream->next;
+  if (size > stream->window)
+    size = stream->window;
+  if (SSC_MemMap_mapRange(&stream->map, stream->next, size, stream->flags))
+    return SSC_MEMMAPSTREAM_CODE_ERR_MAP;
+  SSC_MemMap_advise(&stream->map, SSC_MEMMAP_ADVICE_SEQUENTIAL); /* Only a hint. */
+  end = stream->next + size;
+  /* The final window does not need to be revisited for its overlap. */
+  if (end == stream->file_size)
+    stream->next = end;
+  else {
+    stream->next = end - stream->overlap;
+    readAhead_(stream->map.file, end, stream->window - stream->overlap);
+  }
+  return SSC_MEMMAPSTREAM_CODE_OK;
+}
+
+SSC_Error_t
+SSC_MemMapStream_seek(SSC_MemMapStream* stream, size_t offset)
+{
+  if (stream->map.ptr && SSC_MemMap_unmap(&stream->map))
+    return -1;
+  stream->next = offset;
+  if (offset < stream->file_size)
+    readAhead_(stream->map.file, offset, stream->window);
+  return 0;
+}
+
+void
+SSC_MemMapStream_del(SSC_MemMapStream* stream)
+{
+  SSC_MemMap_del(&stream->map);
+  *stream = SSC_MEMMAPSTREAM_NULL_LITERAL;
+}
@@ -0,0 +1,307 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "Numa.h"
+#include "Memory.h"
+#define R_ SSC_RESTRICT
+
+#if   defined(SSC_OS_UNIXLIKE)
+ #include <errno.h>
+ #include <stdio.h>
+ #include <sys/mman.h>
+ #if defined(__gnu_linux__)
+  #include <sys/syscall.h>
+  #include <linux/mempolicy.h>
+  #if defined(SYS_mbind) && defined(SYS_set_mempolicy) && defined(SYS_move_pages)
+   #define HAS_MEMPOLICY_
+  #endif
+ #endif
+ #if defined(MAP_ANONYMOUS)
+  #define MAP_ANON_ MAP_ANONYMOUS
+ #else
+  #define MAP_ANON_ MAP_ANON
+ #endif
+ #if defined(__gnu_linux__)
+ typedef unsigned char MincoreVec_t;
+ #else
+ typedef char          MincoreVec_t;
+ #endif
+ #define QUERY_BATCH_ 512
+#elif defined(SSC_OS_WINDOWS)
+ #include <windows.h>
+ #include <psapi.h>
+ #define QUERY_BATCH_ 512
+#else
+ #error "Unsupported operating system."
+#endif
+
+#if defined(HAS_MEMPOLICY_) || defined(SSC_OS_WINDOWS)
+/* Return the index of the lowest set bit of @nodes, which must be nonzero. */
+static unsigned
+lowestNode_(uint64_t nodes)
+{
+  unsigned i = 0;
+  while (!(nodes & 1)) {
+    nodes >>= 1;
+    ++i;
+  }
+  return i;
+}
+#endif
+
+/* Round @n up to a multiple of the power of 2 @mult. */
+static size_t
+roundUp_(size_t n, size_t mult)
+{
+  return (n + (mult - 1)) & ~(mult - 1);
+}
+
+#ifdef HAS_MEMPOLICY_
+/* Translate @policy and @nodes into a kernel mode and node mask.
+ * Return -1 if the combination is invalid. */
+static SSC_Error_t
+mempolicy_(SSC_NumaPolicy_t policy, uint64_t nodes, int* R_ mode, unsigned long* R_ mask)
+{
+  *mask = 0;
+  switch (policy) {
+    case SSC_NUMA_POLICY_DEFAULT:
+      *mode = MPOL_DEFAULT;
+      return 0;
+    case SSC_NUMA_POLICY_BIND:
+      *mode = MPOL_BIND;
+      break;
+    case SSC_NUMA_POLICY_INTERLEAVE:
+      *mode = MPOL_INTERLEAVE;
+      break;
+    case SSC_NUMA_POLICY_PREFERRED:
+      *mode = MPOL_PREFERRED;
+      if (nodes)
+        nodes = UINT64_C(1) << lowestNode_(nodes); /* MPOL_PREFERRED takes exactly one node. */
+      break;
+    default:
+      return -1;
+  }
+  if (!nodes || (nodes >> (sizeof(*mask) * 8 - 1) >> 1))
+    return -1; /* No node was given, or the mask doesn't fit an unsigned long. */
+  *mask = (unsigned long)nodes;
+  return 0;
+}
+#endif
+
+unsigned SSC_Numa_getNodeCount(void)
+{
+#if   defined(SSC_OS_UNIXLIKE)
+ #if defined(__gnu_linux__)
+  /* The possible nodes are listed like "0" or "0-3"; the last number is the highest node. */
+  unsigned last = 0, n;
+  int c;
+  FILE* possible = fopen("/sys/devices/system/node/possible", "r");
+  if (!possible)
+    return 1;
+  n = 0;
+  while ((c = fgetc(possible)) != EOF) {
+    if (c >= '0' && c <= '9')
+      n = (n * 10) + (unsigned)(c - '0');
+    else {
+      if (c == '-' || c == ',' || c == '\n')
+        last = n;
+      n = 0;
+    }
+  }
+  fclose(possible);
+  if (n > last)
+    last = n; /* The list had no trailing newline. */
+  return last + 1;
+ #else
+  return 1;
+ #endif
+#elif defined(SSC_OS_WINDOWS)
+  ULONG highest;
+  if (!GetNumaHighestNodeNumber(&highest))
+    return 1;
+  return (unsigned)highest + 1;
+#endif
+}
+
+SSC_Error_t SSC_Numa_setRangePolicy(void* ptr, size_t size, SSC_NumaPolicy_t policy, uint64_t nodes)
+{
+#ifdef HAS_MEMPOLICY_
+  const size_t  page = SSC_getPageSize();
+  const uintptr_t p  = (uintptr_t)ptr;
+  const uintptr_t lo = p & ~(uintptr_t)(page - 1);
+  unsigned long mask;
+  int mode;
+  if (size == 0)
+    return 0;
+  if (mempolicy_(policy, nodes, &mode, &mask))
+    return -1;
+  if (syscall(SYS_mbind, (void*)lo, roundUp_((size_t)(p - lo) + size, page), mode,
+              (mode == MPOL_DEFAULT) ? SSC_NULL : &mask,
+              (mode == MPOL_DEFAULT) ? 0ul : (unsigned long)(sizeof(mask) * 8 + 1),
+              (unsigned)MPOL_MF_MOVE))
+    return (errno == ENOSYS) ? 0 : -1; /* The kernel was built without NUMA. */
+  return 0;
+#else
+  /* There is no way to direct placement here. */
+  (void)ptr; (void)size; (void)policy; (void)nodes;
+  return 0;
+#endif
+}
+
+SSC_Error_t SSC_Numa_setThreadPolicy(SSC_NumaPolicy_t policy, uint64_t nodes)
+{
+#ifdef HAS_MEMPOLICY_
+  unsigned long mask;
+  int mode;
+  if (mempolicy_(policy, nodes, &mode, &mask))
+    return -1;
+  if (syscall(SYS_set_mempolicy, mode,
+              (mode == MPOL_DEFAULT) ? SSC_NULL : &mask,
+              (mode == MPOL_DEFAULT) ? 0ul : (unsigned long)(sizeof(mask) * 8 + 1)))
+    return (errno == ENOSYS) ? 0 : -1;
+  return 0;
+#else
+  (void)policy; (void)nodes;
+  return 0;
+#endif
+}
+
+void* SSC_Numa_alignedMalloc(size_t alignment, size_t size, SSC_NumaPolicy_t policy, uint64_t nodes)
+{
+  const size_t granularity = SSC_getAllocationGranularity();
+  uint8_t* p;
+
+  if (size == 0 || (alignment & (alignment - 1)))
+    return SSC_NULL;
+  if (alignment < granularity)
+    alignment = granularity;
+  size = roundUp_(size, SSC_getPageSize());
+  if (size > (SIZE_MAX - alignment))
+    return SSC_NULL;
+#if   defined(SSC_OS_UNIXLIKE)
+  {
+    /* Over-map by the excess alignment, then trim the unaligned head and the tail. */
+    const size_t n = size + (alignment - granularity);
+    uint8_t* base = (uint8_t*)mmap(SSC_NULL, n, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON_, -1, 0);
+    size_t head;
+    if (base == (uint8_t*)MAP_FAILED)
+      return SSC_NULL;
+    p = (uint8_t*)roundUp_((size_t)(uintptr_t)base, alignment);
+    head = (size_t)(p - base);
+    if (head)
+      munmap(base, head);
+    if (n - head - size)
+      munmap(p + size, n - head - size);
+  }
+  /* Set the policy before the first touch, so that nothing needs to migrate. */
+  if ((policy != SSC_NUMA_POLICY_DEFAULT) && SSC_Numa_setRangePolicy(p, size, policy, nodes)) {
+    munmap(p, size);
+    return SSC_NULL;
+  }
+#elif defined(SSC_OS_WINDOWS)
+  const bool numa = (policy == SSC_NUMA_POLICY_BIND || policy == SSC_NUMA_POLICY_PREFERRED) && nodes;
+  const DWORD node = numa ? (DWORD)lowestNode_(nodes) : 0;
+  p = SSC_NULL;
+  /* Find a free region large enough to align, release it, and allocate at the aligned address
+   * within it. Another thread may claim the region in between, so try again a few times. */
+  for (int tries = 0; (tries < 16) && !p; ++tries) {
+    uint8_t* region = (uint8_t*)VirtualAlloc(SSC_NULL, size + (alignment - granularity), MEM_RESERVE, PAGE_NOACCESS);
+    uint8_t* aligned;
+    if (!region)
+      break;
+    aligned = (uint8_t*)roundUp_((size_t)(uintptr_t)region, alignment);
+    VirtualFree(region, 0, MEM_RELEASE);
+    if (numa)
+      p = (uint8_t*)VirtualAllocExNuma(GetCurrentProcess(), aligned, size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE, node);
+    else
+      p = (uint8_t*)VirtualAlloc(aligned, size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  }
+#endif
+  return p;
+}
+
+void SSC_Numa_alignedFree(void* p, size_t size)
+{
+  if (!p)
+    return;
+#if   defined(SSC_OS_UNIXLIKE)
+  munmap(p, roundUp_(size, SSC_getPageSize()));
+#elif defined(SSC_OS_WINDOWS)
+  (void)size;
+  VirtualFree(p, 0, MEM_RELEASE);
+#endif
+}
+
+/* Store in @nodes the node backing each of the @batch pages from @addr, or -1 for each
+ * page that is not resident. */
+static SSC_Error_t
+queryBatch_(uintptr_t addr, size_t batch, size_t page, int* R_ nodes)
+{
+#if   defined(SSC_OS_UNIXLIKE)
+  MincoreVec_t vec[QUERY_BATCH_];
+ #ifdef HAS_MEMPOLICY_
+  void* addrs[QUERY_BATCH_];
+  for (size_t i = 0; i < batch; ++i)
+    addrs[i] = (void*)(addr + (i * page));
+  /* With no target nodes, move_pages() only reports where each page is.
+   * Pages that aren't resident get negative error codes. */
+  if (!syscall(SYS_move_pages, 0, (unsigned long)batch, addrs, SSC_NULL, nodes, 0)) {
+    for (size_t i = 0; i < batch; ++i) {
+      if (nodes[i] < 0)
+        nodes[i] = -1;
+    }
+    return 0;
+  }
+  if (errno != ENOSYS)
+    return -1;
+ #endif
+  /* Without NUMA, every resident page is on node 0. */
+  if (mincore((void*)addr, batch * page, vec))
+    return -1;
+  for (size_t i = 0; i < batch; ++i)
+    nodes[i] = (vec[i] & 1) ? 0 : -1;
+#elif defined(SSC_OS_WINDOWS)
+  PSAPI_WORKING_SET_EX_INFORMATION info[QUERY_BATCH_];
+  for (size_t i = 0; i < batch; ++i)
+    info[i].VirtualAddress = (PVOID)(addr + (i * page));
+  if (!QueryWorkingSetEx(GetCurrentProcess(), info, (DWORD)(batch * sizeof(info[0]))))
+    return -1;
+  for (size_t i = 0; i < batch; ++i)
+    nodes[i] = info[i].VirtualAttributes.Valid ? (int)info[i].VirtualAttributes.Node : -1;
+#endif
+  return 0;
+}
+
+SSC_Error_t SSC_Numa_getRangeNodes(const void* R_ ptr, size_t size, size_t* R_ per_node, unsigned node_count)
+{
+  const size_t    page  = SSC_getPageSize();
+  const uintptr_t p     = (uintptr_t)ptr;
+  const uintptr_t lo    = p & ~(uintptr_t)(page - 1);
+  const size_t    pages = (size == 0) ? 0 : (roundUp_((size_t)(p - lo) + size, page) / page);
+  int nodes[QUERY_BATCH_];
+
+  /* Query in fixed batches, so that huge ranges need no heap allocation. */
+  for (size_t i = 0; i < pages; i += QUERY_BATCH_) {
+    const size_t batch = ((pages - i) < QUERY_BATCH_) ? (pages - i) : QUERY_BATCH_;
+    if (queryBatch_(lo + (i * page), batch, page, nodes))
+      return -1;
+    for (size_t j = 0; j < batch; ++j) {
+      if (nodes[j] >= 0 && (unsigned)nodes[j] < node_count)
+        ++per_node[nodes[j]];
+    }
+  }
+  return 0;
+}
+
+int SSC_Numa_getNode(const void* ptr)
+{
+  size_t per_node[64] = {0};
+  const unsigned n = SSC_Numa_getNodeCount();
+  const unsigned count = (n < 64) ? n : 64;
+  if (SSC_Numa_getRangeNodes(ptr, 1, per_node, count))
+    return -1;
+  for (unsigned i = 0; i < count; ++i) {
+    if (per_node[i])
+      return (int)i;
+  }
+  return -1;
+}
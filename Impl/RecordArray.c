@@ -0,0 +1,172 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "RecordArray.h"
+#define R_ SSC_RESTRICT
+
+#define HEADER_SIZE_ SSC_RECORDARRAY_HEADER_SIZE
+/* Header field offsets. */
+#define MAGIC_       0
+#define VERSION_     8
+#define ENDIAN_      12
+#define RECORD_SIZE_ 16
+#define COUNT_       24
+
+#define OK_              SSC_RECORDARRAY_INIT_CODE_OK
+#define ERR_MAP_         SSC_RECORDARRAY_INIT_CODE_ERR_MAP
+#define ERR_MAGIC_       SSC_RECORDARRAY_INIT_CODE_ERR_MAGIC
+#define ERR_VERSION_     SSC_RECORDARRAY_INIT_CODE_ERR_VERSION
+#define ERR_RECORD_SIZE_ SSC_RECORDARRAY_INIT_CODE_ERR_RECORD_SIZE
+#define ERR_CORRUPT_     SSC_RECORDARRAY_INIT_CODE_ERR_CORRUPT
+
+static const uint8_t magic_[8] = {'S', 'S', 'C', 'R', 'E', 'C', 'A', 'R'};
+
+/* Size and map the file just created in @arr->map.file, and write an empty array to it. */
+static SSC_CodeError_t
+create_(SSC_RecordArray* arr, size_t record_size, SSC_BitFlag_t flags)
+{
+  if (record_size == 0)
+    return ERR_RECORD_SIZE_;
+  arr->map.size = HEADER_SIZE_ + record_size;
+  if (SSC_File_setSize(arr->map.file, arr->map.size) || SSC_MemMap_map(&arr->map, false))
+    return ERR_MAP_;
+  memset(arr->map.ptr, 0, HEADER_SIZE_);
+  memcpy(arr->map.ptr + MAGIC_, magic_, sizeof(magic_));
+  SSC_storeLittleEndian32(arr->map.ptr + VERSION_, SSC_RECORDARRAY_VERSION);
+  SSC_storeLittleEndian32(
+   arr->map.ptr + ENDIAN_,
+   (flags & SSC_RECORDARRAY_INIT_BIG_ENDIAN) ? SSC_RECORDARRAY_BIG_ENDIAN : SSC_RECORDARRAY_LITTLE_ENDIAN);
+  SSC_storeLittleEndian64(arr->map.ptr + RECORD_SIZE_, (uint64_t)record_size);
+  SSC_storeLittleEndian64(arr->map.ptr + COUNT_, 0);
+  arr->record_size = record_size;
+  arr->count = 0;
+  return OK_;
+}
+
+/* Map and validate the existing array opened in @arr->map.file. */
+static SSC_CodeError_t
+open_(SSC_RecordArray* arr, size_t record_size, SSC_BitFlag_t flags)
+{
+  uint64_t file_record_size, count;
+
+  if (SSC_File_getSize(arr->map.file, &arr->map.size))
+    return ERR_MAP_;
+  if (arr->map.size < HEADER_SIZE_)
+    return ERR_MAGIC_;
+  if (SSC_MemMap_map(&arr->map, (flags & SSC_RECORDARRAY_INIT_READONLY)))
+    return ERR_MAP_;
+  if (memcmp(arr->map.ptr + MAGIC_, magic_, sizeof(magic_)))
+    return ERR_MAGIC_;
+  if (SSC_loadLittleEndian32(arr->map.ptr + VERSION_) != SSC_RECORDARRAY_VERSION)
+    return ERR_VERSION_;
+  file_record_size = SSC_loadLittleEndian64(arr->map.ptr + RECORD_SIZE_);
+  if (file_record_size == 0 || file_record_size > SIZE_MAX || (record_size && (record_size != file_record_size)))
+    return ERR_RECORD_SIZE_;
+  count = SSC_loadLittleEndian64(arr->map.ptr + COUNT_);
+  if (count > ((arr->map.size - HEADER_SIZE_) / file_record_size))
+    return ERR_CORRUPT_;
+  arr->record_size = (size_t)file_record_size;
+  arr->count = (size_t)count;
+  return OK_;
+}
+
+SSC_CodeError_t SSC_RecordArray_init(
+ SSC_RecordArray* R_ arr,
+ const char* R_      filepath,
+ size_t              record_size,
+ SSC_BitFlag_t       flags)
+{
+  SSC_BitFlag_t   oflags = SSC_FILEPATH_OPEN_CREATE;
+  SSC_CodeError_t ce;
+  bool            created = false;
+
+  /* There is nothing to open readonly, so only create when writing. */
+  if (flags & SSC_RECORDARRAY_INIT_READONLY)
+    oflags = SSC_FILEPATH_OPEN_READONLY;
+  *arr = SSC_RECORDARRAY_NULL_LITERAL;
+  /* Let the open decide whether the array exists, rather than asking first. */
+  if (SSC_FilePath_openOrCreate(filepath, oflags, &arr->map.file, &created))
+    ce = ERR_MAP_;
+  else if (created)
+    ce = create_(arr, record_size, flags);
+  else
+    ce = open_(arr, record_size, flags);
+  if (ce) {
+    SSC_MemMap_del(&arr->map);
+    *arr = SSC_RECORDARRAY_NULL_LITERAL;
+    if (created)
+      remove(filepath);
+  }
+  return ce;
+}
+
+void SSC_RecordArray_initOrDie(
+ SSC_RecordArray* R_ arr,
+ const char* R_      filepath,
+ size_t              record_size,
+ SSC_BitFlag_t       flags)
+{
+  const char* err_str;
+  switch (SSC_RecordArray_init(arr, filepath, record_size, flags)) {
+    case OK_:
+      return;
+    case ERR_MAP_:
+      err_str = "Failed to map the file";
+      break;
+    case ERR_MAGIC_:
+      err_str = "The file is not a record array";
+      break;
+    case ERR_VERSION_:
+      err_str = "Unsupported record array version";
+      break;
+    case ERR_RECORD_SIZE_:
+      err_str = "Invalid record size";
+      break;
+    case ERR_CORRUPT_:
+      err_str = "The record count exceeds the file";
+      break;
+    default:
+      err_str = "Invalid SSC_CodeError_t";
+      break;
+  }
+  SSC_errx("Error: %s in SSC_RecordArray_initOrDie() for ``%s''!\n", err_str, filepath);
+}
+
+uint8_t* SSC_RecordArray_append(SSC_RecordArray* R_ arr, const void* R_ record)
+{
+  uint8_t* p;
+  size_t   end;
+
+  if (arr->map.readonly || arr->count >= ((SIZE_MAX - HEADER_SIZE_) / arr->record_size))
+    return SSC_NULL;
+  end = HEADER_SIZE_ + ((arr->count + 1) * arr->record_size);
+  if (SSC_MemMap_reserve(&arr->map, end))
+    return SSC_NULL;
+  p = arr->map.ptr + (end - arr->record_size);
+  if (record)
+    memcpy(p, record, arr->record_size);
+  else
+    memset(p, 0, arr->record_size);
+  ++arr->count;
+  SSC_storeLittleEndian64(arr->map.ptr + COUNT_, (uint64_t)arr->count);
+  return p;
+}
+
+SSC_Error_t SSC_RecordArray_truncate(SSC_RecordArray* arr, size_t count)
+{
+  if (arr->map.readonly || count > arr->count)
+    return -1;
+  arr->count = count;
+  SSC_storeLittleEndian64(arr->map.ptr + COUNT_, (uint64_t)count);
+  return 0;
+}
+
+void SSC_RecordArray_del(SSC_RecordArray* arr)
+{
+  if (arr->map.ptr && !arr->map.readonly) {
+    const size_t size = HEADER_SIZE_ + (arr->count * arr->record_size);
+    if (size != arr->map.size)
+      SSC_MemMap_resize(&arr->map, size); /* Only tidies the file; the records are intact either way. */
+  }
+  SSC_MemMap_del(&arr->map);
+  *arr = SSC_RECORDARRAY_NULL_LITERAL;
+}
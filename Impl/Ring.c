@@ -0,0 +1,194 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "Ring.h"
+#include "Atomic.h"
+#include "Memory.h"
+#define R_ SSC_RESTRICT
+
+#define HEADER_SIZE_ SSC_RING_HEADER_SIZE
+/* Header field offsets. */
+#define MAGIC_      0
+#define SLOT_SIZE_  8
+#define SLOT_COUNT_ 16
+#define HEAD_       128
+#define TAIL_       256
+
+#define OK_            SSC_RING_INIT_CODE_OK
+#define ERR_MAP_       SSC_RING_INIT_CODE_ERR_MAP
+#define ERR_GEOMETRY_  SSC_RING_INIT_CODE_ERR_GEOMETRY
+#define ERR_NOT_READY_ SSC_RING_INIT_CODE_ERR_NOT_READY
+
+static const uint8_t magic_[8] = {'S', 'S', 'C', 'R', 'I', 'N', 'G', '1'};
+
+/* Map @size bytes at @name, creating them when @create is true. */
+static SSC_CodeError_t
+map_(SSC_MemMap* R_ map, const char* R_ name, size_t size, bool create, SSC_BitFlag_t flags)
+{
+  SSC_BitFlag_t mflags = SSC_MEMMAP_INIT_FORCE_EXIST;
+  if (!create)
+    mflags |= SSC_MEMMAP_INIT_FORCE_EXIST_YES;
+  /* Only a created shared-memory ring may be unnamed; there is nothing to open by no name. */
+  if (!name && (!create || (flags & SSC_RING_INIT_FILEPATH)))
+    return ERR_MAP_;
+  if (flags & SSC_RING_INIT_FILEPATH)
+    return SSC_MemMap_init(map, name, size, mflags);
+  return SSC_MemMap_initShared(map, name, size, mflags);
+}
+
+/* Point the members of @ring into its mapping. */
+static void
+attach_(SSC_Ring* ring, size_t slot_size, size_t slot_count)
+{
+  ring->slots = ring->map.ptr + HEADER_SIZE_;
+  ring->head = (volatile uint64_t*)(ring->map.ptr + HEAD_);
+  ring->tail = (volatile uint64_t*)(ring->map.ptr + TAIL_);
+  ring->slot_size = slot_size;
+  ring->mask = (uint64_t)slot_count - 1;
+  ring->seen_head = SSC_atomicLoad64(ring->head);
+  ring->seen_tail = SSC_atomicLoad64(ring->tail);
+}
+
+SSC_CodeError_t SSC_Ring_create(
+ SSC_Ring* R_   ring,
+ const char* R_ name,
+ size_t         slot_size,
+ size_t         slot_count,
+ SSC_BitFlag_t  flags)
+{
+  uint64_t magic;
+
+  *ring = SSC_RING_NULL_LITERAL;
+  if (slot_size == 0 || slot_size > UINT32_MAX || slot_count == 0 || (slot_count & (slot_count - 1)))
+    return ERR_GEOMETRY_;
+  if (slot_count > ((SIZE_MAX - HEADER_SIZE_) / slot_size))
+    return ERR_GEOMETRY_;
+  if (map_(&ring->map, name, HEADER_SIZE_ + (slot_size * slot_count), true, flags)) {
+    SSC_MemMap_del(&ring->map);
+    *ring = SSC_RING_NULL_LITERAL;
+    return ERR_MAP_;
+  }
+  memset(ring->map.ptr, 0, HEADER_SIZE_);
+  SSC_storeLittleEndian32(ring->map.ptr + SLOT_SIZE_, (uint32_t)slot_size);
+  SSC_storeLittleEndian64(ring->map.ptr + SLOT_COUNT_, (uint64_t)slot_count);
+  attach_(ring, slot_size, slot_count);
+  /* Publish the magic last, so that openers never see a partial header. */
+  memcpy(&magic, magic_, sizeof(magic));
+  SSC_atomicStore64((volatile uint64_t*)(ring->map.ptr + MAGIC_), magic);
+  return OK_;
+}
+
+SSC_CodeError_t SSC_Ring_open(SSC_Ring* R_ ring, const char* R_ name, SSC_BitFlag_t flags)
+{
+  uint64_t magic, slot_count;
+  size_t   slot_size;
+  SSC_CodeError_t ce = OK_;
+
+  *ring = SSC_RING_NULL_LITERAL;
+  switch (map_(&ring->map, name, 0, false, flags)) {
+    case SSC_MEMMAP_INIT_CODE_OK:
+      break;
+    case SSC_MEMMAP_INIT_CODE_ERR_NOSIZE:
+      ce = ERR_NOT_READY_; /* The creator hasn't sized the memory yet. */
+      break;
+    default:
+      ce = ERR_MAP_;
+      break;
+  }
+  if (!ce && ring->map.size < HEADER_SIZE_)
+    ce = ERR_NOT_READY_;
+  if (!ce) {
+    magic = SSC_atomicLoad64((const volatile uint64_t*)(ring->map.ptr + MAGIC_));
+    if (memcmp(&magic, magic_, sizeof(magic)))
+      ce = ERR_NOT_READY_;
+  }
+  if (!ce) {
+    slot_size = (size_t)SSC_loadLittleEndian32(ring->map.ptr + SLOT_SIZE_);
+    slot_count = SSC_loadLittleEndian64(ring->map.ptr + SLOT_COUNT_);
+    if (slot_size == 0 || slot_count == 0 || (slot_count & (slot_count - 1)) ||
+        slot_count > ((ring->map.size - HEADER_SIZE_) / slot_size))
+      ce = ERR_GEOMETRY_;
+    else
+      attach_(ring, slot_size, (size_t)slot_count);
+  }
+  if (ce) {
+    SSC_MemMap_del(&ring->map);
+    *ring = SSC_RING_NULL_LITERAL;
+  }
+  return ce;
+}
+
+size_t SSC_Ring_writeBegin(SSC_Ring* R_ ring, size_t n, uint8_t** R_ first)
+{
+  const uint64_t head  = *ring->head; /* Only the producer writes @head. */
+  const uint64_t count = ring->mask + 1;
+  const uint64_t index = head & ring->mask;
+  uint64_t avail = count - (head - ring->seen_tail);
+
+  /* Only read the consumer's cache line when the ring looks too full. */
+  if (avail < n) {
+    ring->seen_tail = SSC_atomicLoad64(ring->tail);
+    avail = count - (head - ring->seen_tail);
+  }
+  if (avail > (count - index))
+    avail = count - index;
+  if (avail > n)
+    avail = n;
+  *first = ring->slots + (index * ring->slot_size);
+  return (size_t)avail;
+}
+
+void SSC_Ring_writeEnd(SSC_Ring* ring, size_t n)
+{
+  SSC_atomicStore64(ring->head, *ring->head + n);
+}
+
+bool SSC_Ring_push(SSC_Ring* R_ ring, const void* R_ slot)
+{
+  uint8_t* p;
+  if (!SSC_Ring_writeBegin(ring, 1, &p))
+    return false;
+  memcpy(p, slot, ring->slot_size);
+  SSC_Ring_writeEnd(ring, 1);
+  return true;
+}
+
+size_t SSC_Ring_readBegin(SSC_Ring* R_ ring, size_t n, const uint8_t** R_ first)
+{
+  const uint64_t tail  = *ring->tail; /* Only the consumer writes @tail. */
+  const uint64_t count = ring->mask + 1;
+  const uint64_t index = tail & ring->mask;
+  uint64_t avail = ring->seen_head - tail;
+
+  /* Only read the producer's cache line when the ring looks too empty. */
+  if (avail < n) {
+    ring->seen_head = SSC_atomicLoad64(ring->head);
+    avail = ring->seen_head - tail;
+  }
+  if (avail > (count - index))
+    avail = count - index;
+  if (avail > n)
+    avail = n;
+  *first = ring->slots + (index * ring->slot_size);
+  return (size_t)avail;
+}
+
+void SSC_Ring_readEnd(SSC_Ring* ring, size_t n)
+{
+  SSC_atomicStore64(ring->tail, *ring->tail + n);
+}
+
+bool SSC_Ring_pop(SSC_Ring* R_ ring, void* R_ slot)
+{
+  const uint8_t* p;
+  if (!SSC_Ring_readBegin(ring, 1, &p))
+    return false;
+  memcpy(slot, p, ring->slot_size);
+  SSC_Ring_readEnd(ring, 1);
+  return true;
+}
+
+void SSC_Ring_del(SSC_Ring* ring)
+{
+  SSC_MemMap_del(&ring->map);
+  *ring = SSC_RING_NULL_LITERAL;
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information. */
+#include "Thread.h"
+#define R_ SSC_RESTRICT
+
+/* Threads begin in start_(), which unpacks and frees this, then calls @func(@arg). */
+typedef struct {
+  SSC_ThreadFunc_f func;
+  void*            arg;
+} Start_;
+
+#if   defined(SSC_OS_UNIXLIKE)
+static void*
+start_(void* p)
+{
+  const Start_ s = *(Start_*)p;
+  free(p);
+  s.func(s.arg);
+  return SSC_NULL;
+}
+#elif defined(SSC_OS_WINDOWS)
+static DWORD WINAPI
+start_(LPVOID p)
+{
+  const Start_ s = *(Start_*)p;
+  free(p);
+  s.func(s.arg);
+  return 0;
+}
+#else
+ #error "Unsupported operating system."
+#endif
+
+SSC_Error_t SSC_Thread_create(SSC_Thread_t* R_ thread, SSC_ThreadFunc_f func, void* R_ arg)
+{
+  Start_* s = (Start_*)malloc(sizeof(Start_));
+  if (!s)
+    return -1;
+  s->func = func;
+  s->arg = arg;
+#if   defined(SSC_OS_UNIXLIKE)
+  if (pthread_create(thread, SSC_NULL, start_, s)) {
+    free(s);
+    return -1;
+  }
+#elif defined(SSC_OS_WINDOWS)
+  *thread = CreateThread(SSC_NULL, 0, start_, s, 0, SSC_NULL);
+  if (*thread == SSC_NULL) {
+    free(s);
+    return -1;
+  }
+#endif
+  return 0;
+}
+
+SSC_Error_t SSC_Thread_join(SSC_Thread_t thread)
+{
+#if   defined(SSC_OS_UNIXLIKE)
+  return pthread_join(thread, SSC_NULL) ? -1 : 0;
+#elif defined(SSC_OS_WINDOWS)
+  SSC_Error_t ret = 0;
+  if (WaitForSingleObject(thread, INFINITE) != WAIT_OBJECT_0)
+    ret = -1;
+  if (!CloseHandle(thread))
+    ret = -1;
+  return ret;
+#endif
+}
@@ -0,0 +1,150 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define an append-only journal of variable-size records stored in a
+ * memory-mapped file. Threads append concurrently without locking, by reserving space
+ * with an atomic fetch-add, and records become durable once they are committed.
+ *
+ *   Offset | Size | Field
+ *   -------+------+------------------------------------------------------------
+ *        0 |    8 | Magic bytes, "SSCJRNAL".
+ *        8 |    4 | Format version. (SSC_JOURNAL_VERSION)
+ *       12 |    4 | Reserved; zero.
+ *       16 |    8 | Commit marker: the offset just past the last committed record.
+ *       24 |   40 | Reserved; zero.
+ *       64 |  ... | Records.
+ *
+ * Each record is an 8-byte header (its payload length, then a 32-bit FNV-1a checksum of
+ * its payload) followed by its payload, padded to a multiple of 8 bytes. All fields are
+ * little endian. A header of zero marks space that was never published. */
+#ifndef SSC_JOURNAL_H
+#define SSC_JOURNAL_H
+
+#include <stdbool.h>
+
+#include "Error.h"
+#include "Macro.h"
+#include "MemMap.h"
+
+#define SSC_JOURNAL_HEADER_SIZE 64 /* The first record begins at this file offset. */
+#define SSC_JOURNAL_VERSION     1
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Journal
+ *   The file is mapped at its full capacity up front, so that appending never moves the
+ *   mapping while other threads are writing to it. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  SSC_MemMap      map;       /* The mapped file. @map.size is the capacity of the journal. */
+  volatile size_t tail;      /* The offset of the first unreserved byte. */
+  size_t          committed; /* The offset just past the last committed record. */
+} SSC_Journal;
+#define SSC_JOURNAL_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_Journal, SSC_MEMMAP_NULL_LITERAL, 0, 0)
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_JOURNAL_INIT_READONLY = 0x01, /* Open an existing journal to read its records only. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Error Codes
+ *     SSC_CodeError_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_JOURNAL_INIT_CODE_OK          =  0,
+  SSC_JOURNAL_INIT_CODE_ERR_MAP     = -1, /* Failed to create, open, map or resize the file. */
+  SSC_JOURNAL_INIT_CODE_ERR_MAGIC   = -2, /* The file is not a journal. */
+  SSC_JOURNAL_INIT_CODE_ERR_VERSION = -3, /* The file's format version is unsupported. */
+  SSC_JOURNAL_INIT_CODE_ERR_CORRUPT = -4, /* The commit marker lies outside the file. */
+  SSC_JOURNAL_INIT_CODE_ERR_RECOVER = -5, /* Failed to truncate torn records. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Open the journal at @filepath, creating an empty one if there is no file there; when
+ * creating it fails, the new file is removed. The file is made at least @capacity bytes long.
+ * On opening, committed records are kept, as are the intact records that directly follow
+ * them; the first torn or unpublished record and everything after it is truncated away,
+ * and the commit marker is advanced past the kept records. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_Journal_init(
+ SSC_Journal* R_ journal,
+ const char* R_  filepath,
+ size_t          capacity,
+ SSC_BitFlag_t   flags);
+
+SSC_API void
+SSC_Journal_initOrDie(
+ SSC_Journal* R_ journal,
+ const char* R_  filepath,
+ size_t          capacity,
+ SSC_BitFlag_t   flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Reserve space for a record with a payload of @size bytes, and return a pointer to the
+ * payload, or SSC_NULL when the journal is full. Any number of threads may reserve and
+ * publish at once. Every reservation must be published with SSC_Journal_publish(); until it
+ * is, no later record can be committed. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API uint8_t*
+SSC_Journal_reserve(SSC_Journal* journal, size_t size);
+
+/* Publish the record whose @size byte payload at @payload was written since it was
+ * returned by SSC_Journal_reserve(). */
+SSC_API void
+SSC_Journal_publish(SSC_Journal* R_ journal, uint8_t* R_ payload, size_t size);
+
+/* Reserve, copy and publish the @size bytes at @data as one record. */
+SSC_API SSC_Error_t
+SSC_Journal_append(SSC_Journal* R_ journal, const void* R_ data, size_t size);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Make the published records after the commit marker durable: synchronize them with
+ * the filesystem, then advance the commit marker past them and synchronize the header.
+ * Only the records preceding the first unpublished reservation are committed.
+ * Threads may append during a commit, but only one thread may commit at a time. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_Journal_commit(SSC_Journal* journal);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Iterate over the committed records. Begin with *@cursor = SSC_JOURNAL_HEADER_SIZE.
+ * Each call returns a pointer to the payload of the record at *@cursor, stores its length
+ * in @size, and advances *@cursor to the next record. Returns SSC_NULL after the last. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API const uint8_t*
+SSC_Journal_next(const SSC_Journal* R_ journal, size_t* R_ cursor, size_t* R_ size);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Grow the capacity of @journal to @capacity bytes, so that appending can resume once
+ * SSC_Journal_reserve() reports it full. No other thread may use @journal meanwhile,
+ * and every reservation must have been published. The mapping may move. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_Journal_grow(SSC_Journal* journal, size_t capacity);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Unmap and close the journal. Uncommitted records are not synchronized. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void
+SSC_Journal_del(SSC_Journal* journal);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_JOURNAL_H */
@@ -0,0 +1,106 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define a circular byte buffer over a mirrored memory-map
+ * (see SSC_MemMap_initMirrored()). Because the buffer's memory appears twice in a row,
+ * the readable and writable regions are always contiguous, and records that wrap around
+ * the end of the buffer never need to be copied back together.
+ * A SSC_MagicRing is not safe to use from several threads at once. */
+#ifndef SSC_MAGICRING_H
+#define SSC_MAGICRING_H
+
+#include "Error.h"
+#include "Macro.h"
+#include "MemMap.h"
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Magic Ring Buffer */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  SSC_MemMap map;  /* The mirrored memory. @map.size is the capacity of the ring. */
+  size_t     read; /* The offset of the first readable byte. (@read < @map.size) */
+  size_t     used; /* The number of readable bytes. */
+} SSC_MagicRing;
+#define SSC_MAGICRING_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MagicRing, SSC_MEMMAP_NULL_LITERAL, 0, 0)
+/*=========================================================================================*/
+
+/* Allocate a ring of at least @capacity bytes. The capacity is rounded up to the
+ * allocation granularity; @ring->map.size holds the actual capacity. */
+SSC_INLINE SSC_Error_t
+SSC_MagicRing_init(SSC_MagicRing* ring, size_t capacity)
+{
+  ring->read = 0;
+  ring->used = 0;
+  return SSC_MemMap_initMirrored(&ring->map, capacity);
+}
+
+SSC_INLINE void
+SSC_MagicRing_initOrDie(SSC_MagicRing* ring, size_t capacity)
+{
+  SSC_assertMsg(!SSC_MagicRing_init(ring, capacity), "Error: SSC_MagicRing_init() failed!\n");
+}
+
+/* How many bytes may be read from @ring? */
+SSC_INLINE size_t
+SSC_MagicRing_readable(const SSC_MagicRing* ring)
+{
+  return ring->used;
+}
+
+/* How many bytes may be written to @ring? */
+SSC_INLINE size_t
+SSC_MagicRing_writable(const SSC_MagicRing* ring)
+{
+  return ring->map.size - ring->used;
+}
+
+/* Return a pointer to the SSC_MagicRing_readable() contiguous bytes that may be read. */
+SSC_INLINE uint8_t*
+SSC_MagicRing_readPtr(const SSC_MagicRing* ring)
+{
+  return ring->map.ptr + ring->read;
+}
+
+/* Return a pointer to the SSC_MagicRing_writable() contiguous bytes that may be written. */
+SSC_INLINE uint8_t*
+SSC_MagicRing_writePtr(const SSC_MagicRing* ring)
+{
+  size_t w = ring->read + ring->used;
+  if (w >= ring->map.size)
+    w -= ring->map.size;
+  return ring->map.ptr + w;
+}
+
+/* Mark @n bytes written at SSC_MagicRing_writePtr() readable. (@n <= SSC_MagicRing_writable()) */
+SSC_INLINE void
+SSC_MagicRing_produce(SSC_MagicRing* ring, size_t n)
+{
+  ring->used += n;
+}
+
+/* Discard @n bytes from SSC_MagicRing_readPtr(). (@n <= SSC_MagicRing_readable()) */
+SSC_INLINE void
+SSC_MagicRing_consume(SSC_MagicRing* ring, size_t n)
+{
+  ring->read += n;
+  if (ring->read >= ring->map.size)
+    ring->read -= ring->map.size;
+  ring->used -= n;
+}
+
+/* Unmap the ring. */
+SSC_INLINE void
+SSC_MagicRing_del(SSC_MagicRing* ring)
+{
+  SSC_MemMap_del(&ring->map);
+  ring->read = 0;
+  ring->used = 0;
+}
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_MAGICRING_H */
@@ -8,18 +8,13 @@
 #include "Error.h"
 #include "File.h"
 #include "Macro.h"
+#include "Memory.h"
+#include "Numa.h"
 
 #if defined(SSC_OS_UNIXLIKE)
- #define SSC_MEMMAP_SYNC_IMPL_FUNCTION  msync
- #define SSC_MEMMAP_SYNC_IMPL(M) { return SSC_MEMMAP_SYNC_IMPL_FUNCTION(M->ptr, M->size, MS_SYNC); }
  #include <sys/mman.h>
 #elif defined(SSC_OS_WINDOWS)
  #define SSC_MEMMAP_HAS_WINDOWS_FILEMAP
- #define SSC_MEMMAP_SYNC_IMPL(M) {\
-  if (FlushViewOfFile((LPCVOID)M->ptr, M->size))\
-    return 0;\
-  return -1;\
- }
  #include <memoryapi.h>
  #include <windows.h>
 #else
@@ -33,19 +28,53 @@ SSC_BEGIN_C_DECLS
 /* Memory Map */
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 typedef struct {
-  uint8_t*   ptr;
-  size_t     size;
-  SSC_File_t file;
+  uint8_t*      ptr;       /* The first mapped byte requested by the caller. */
+  size_t        size;      /* The number of bytes requested by the caller, beginning at @ptr. */
+  uint8_t*      base;      /* The aligned base address of the mapping. (@base <= @ptr) */
+  size_t        offset;    /* The file offset corresponding to @ptr. */
+  SSC_File_t    file;
   #ifdef SSC_MEMMAP_HAS_WINDOWS_FILEMAP
-  SSC_File_t windows_filemap;
+  SSC_File_t    windows_filemap;
   #endif
-  bool       readonly;
+  size_t        page_size; /* The size of the pages actually backing the mapping. */
+  SSC_BitFlag_t flags;     /* The SSC_MEMMAP_MAP_* flags the mapping was created with. */
+  bool          readonly;
 } SSC_MemMap;
 #ifdef SSC_MEMMAP_HAS_WINDOWS_FILEMAP
- #define SSC_MEMMAP_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MemMap, SSC_NULL, 0, SSC_FILE_NULL_LITERAL, SSC_FILE_NULL_LITERAL, false)
+ #define SSC_MEMMAP_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MemMap, SSC_NULL, 0, SSC_NULL, 0, SSC_FILE_NULL_LITERAL, SSC_FILE_NULL_LITERAL, 0, 0, false)
 #else
- #define SSC_MEMMAP_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MemMap, SSC_NULL, 0, SSC_FILE_NULL_LITERAL, false)
+ #define SSC_MEMMAP_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MemMap, SSC_NULL, 0, SSC_NULL, 0, SSC_FILE_NULL_LITERAL, 0, 0, false)
 #endif
+
+/* How many bytes are actually mapped, beginning at @map->base? */
+SSC_INLINE size_t
+SSC_MemMap_baseSize(const SSC_MemMap* map)
+{
+  return map->size + (size_t)(map->ptr - map->base);
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Mapping Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_MEMMAP_MAP_READONLY = 0x01, /* Map the file with read permissions only. */
+  SSC_MEMMAP_MAP_PREFAULT = 0x02, /* Fault every page of the mapping in before returning. */
+  /* Ask for transparent huge pages with MADV_HUGEPAGE. The kernel grants them opportunistically,
+   * so @page_size continues to report the base page size. */
+  SSC_MEMMAP_MAP_HUGEPAGE = 0x04,
+  /* Use explicit (hugetlbfs) huge pages where the backing memory supports them.
+   * Otherwise fall back to SSC_MEMMAP_MAP_HUGEPAGE. @page_size reports which was obtained. */
+  SSC_MEMMAP_MAP_HUGETLB  = 0x08,
+  /* Map the file copy-on-write. (MAP_PRIVATE / FILE_MAP_COPY) Writes to the mapping are
+   * private to this process and are never written back to the file, so the file may be
+   * open readonly. Pages are only copied when first written. */
+  SSC_MEMMAP_MAP_PRIVATE  = 0x10,
+  /* The @size bytes at @ptr are mapped a second time directly after themselves.
+   * Set by SSC_MemMap_initMirrored(); not accepted by SSC_MemMap_mapRange(). */
+  SSC_MEMMAP_MAP_MIRRORED = 0x20,
+};
 /*=========================================================================================*/
 
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
@@ -60,6 +89,24 @@ enum {
    * if SSC_MEMMAP_INIT_FORCE_EXIST_YES is on, enforce that the file already exists.
    * else, enforce that the file DOESN'T already exist. */
   SSC_MEMMAP_INIT_FORCE_EXIST_YES = 0x08,
+  /* Advise the OS how the mapping will be accessed, once it is mapped.
+   * See SSC_MemMap_advise(). */
+  SSC_MEMMAP_INIT_ADVISE_SEQUENTIAL = 0x10, /* Expect sequential access. */
+  SSC_MEMMAP_INIT_ADVISE_RANDOM     = 0x20, /* Expect random access. */
+  SSC_MEMMAP_INIT_ADVISE_WILLNEED   = 0x40, /* Expect to access the whole mapping soon. */
+  SSC_MEMMAP_INIT_ADVISE_DONTNEED   = 0x80, /* Do not expect to access the mapping soon. */
+  /* Fault in every page of the mapping up front, so that first accesses don't fault.
+   * See SSC_MEMMAP_MAP_PREFAULT. */
+  SSC_MEMMAP_INIT_PREFAULT = 0x100,
+  /* Back the mapping with huge pages. See SSC_MEMMAP_MAP_HUGEPAGE and SSC_MEMMAP_MAP_HUGETLB. */
+  SSC_MEMMAP_INIT_HUGEPAGE = 0x200,
+  SSC_MEMMAP_INIT_HUGETLB  = 0x400,
+  /* Open an existing file readonly, and map it writable copy-on-write.
+   * See SSC_MEMMAP_MAP_PRIVATE. */
+  SSC_MEMMAP_INIT_PRIVATE  = 0x800,
+  /* Create unnamed shared memory that SSC_MemMap_seal() may seal.
+   * Only applies to SSC_MemMap_initShared() with a SSC_NULL name. */
+  SSC_MEMMAP_INIT_SEALABLE = 0x1000,
 };
 /*=========================================================================================*/
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
@@ -78,6 +125,8 @@ enum {
   SSC_MEMMAP_INIT_CODE_ERR_GET_FILE_SIZE =   -8, /* Failed to get a file size. */
   SSC_MEMMAP_INIT_CODE_ERR_SET_FILE_SIZE =   -9, /* Failed to set a file size. */
   SSC_MEMMAP_INIT_CODE_ERR_MAP =            -10, /* Failed to map a file into memory. */
+  SSC_MEMMAP_INIT_CODE_ERR_ADVISE =         -11, /* Failed to advise the OS of the access pattern. */
+  SSC_MEMMAP_INIT_CODE_ERR_SEALS =          -12, /* The memory is not sealed against modification. */
 };
 /*=========================================================================================*/
 
@@ -101,17 +150,103 @@ SSC_MemMap_initOrDie(
  SSC_BitFlag_t  flags);
 /*=========================================================================================*/
 
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Map @size bytes of zero-initialized private memory, backed by no file.
+ * @map->file is left as SSC_FILE_NULL_LITERAL. Of the init flags, only the advice,
+ * prefault and huge page flags apply. With SSC_MEMMAP_INIT_HUGETLB, explicit huge
+ * pages are tried first (MAP_HUGETLB; large pages on Windows). */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_MemMap_initAnonymous(
+ SSC_MemMap*   map,
+ size_t        size,
+ SSC_BitFlag_t flags);
+
+SSC_API void
+SSC_MemMap_initAnonymousOrDie(
+ SSC_MemMap*   map,
+ size_t        size,
+ SSC_BitFlag_t flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Map shared memory that is not backed by the filesystem, so that several processes can
+ * share it without copying.
+ * When @name is not SSC_NULL, the POSIX shared memory object @name (e.g. "/name") is opened
+ * with shm_open(), being created if necessary (a named section on Windows).
+ * When @name is SSC_NULL, an unnamed object is created with memfd_create() (or SHM_ANON, or
+ * an immediately unlinked shm_open() name) and can be shared by passing @map->file to
+ * other processes; children inherit it across fork().
+ * If @size is nonzero, the object is resized to @size bytes; otherwise the object's
+ * existing size is used. The READONLY, ALLOWSHRINK and FORCE_EXIST init flags apply as they do
+ * to SSC_MemMap_init(), alongside the advice, prefault and huge page flags. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_MemMap_initShared(
+ SSC_MemMap* R_ map,
+ const char* R_ name,
+ size_t         size,
+ SSC_BitFlag_t  flags);
+
+SSC_API void
+SSC_MemMap_initSharedOrDie(
+ SSC_MemMap* R_ map,
+ const char* R_ name,
+ size_t         size,
+ SSC_BitFlag_t  flags);
+
+/* Remove the name of the POSIX shared memory object @name. The object itself is freed once
+ * nothing refers to it. On Windows named sections are freed with their last handle, and this does nothing. */
+SSC_API SSC_Error_t
+SSC_MemMap_unlinkShared(const char* name);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Sealing
+ *   A producer fills shared memory created with SSC_MEMMAP_INIT_SEALABLE, then seals it so
+ *   that no process may ever write, shrink or grow it again, and hands @map->file to
+ *   consumers. A consumer that maps it with SSC_MemMap_initSealed() knows the contents cannot
+ *   change beneath it, so it may use them in place without validating a private copy.
+ *   Sealing requires memfd seals (Linux, FreeBSD); elsewhere it always fails. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Seal the memory of @map against writes, shrinking and growing, and remap it readonly.
+ * Fails if the memory isn't sealable, or if any other process has it mapped writable. */
+SSC_API SSC_Error_t
+SSC_MemMap_seal(SSC_MemMap* map);
+
+/* Map all of the sealed memory @file readonly, according to the advice, prefault and huge page
+ * init flags @flags. Returns SSC_MEMMAP_INIT_CODE_ERR_SEALS if @file is not sealed against
+ * writes, shrinking and growing. @map takes ownership of @file, even on failure. */
+SSC_API SSC_CodeError_t
+SSC_MemMap_initSealed(SSC_MemMap* map, SSC_File_t file, SSC_BitFlag_t flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Map @size bytes of zero-initialized shared memory twice, back to back, so that
+ * (@map->ptr + @map->size + i) aliases (@map->ptr + i). Any run of up to @map->size bytes
+ * beginning in the first half is then contiguous, even where it wraps around, which suits
+ * circular buffers. (See MagicRing.h.) @size is rounded up to the allocation granularity.
+ * The memory is an unnamed shared memory object (as SSC_MemMap_initShared() creates with
+ * a SSC_NULL name) on Unixlikes, and a pagefile-backed section on Windows.
+ * Mirrored maps cannot be resized. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_initMirrored(SSC_MemMap* map, size_t size);
+/*=========================================================================================*/
+
 #if defined(SSC_FILE_IS_INT)
  #define MEMMAP_DUMP_ \
   "Error: %s. Dump:\n"\
   "map->ptr      = %p.\n"\
   "map->size     = %zu.\n"\
+  "map->offset   = %zu.\n"\
   "map->file     = %d.\n"\
   "map->readonly = %s.\n"
  #define MEMMAP_DUMP_ARGS_(Map, Err) \
   Err,\
   (void*)Map->ptr,\
   Map->size,\
+  Map->offset,\
   Map->file,\
   Map->readonly ? "ReadOnly" : "ReadWrite"
 #else
@@ -119,11 +254,13 @@ SSC_MemMap_initOrDie(
   "Error: %s. Dump:\n"\
   "map->ptr      = %p.\n"\
   "map->size     = %zu.\n"\
+  "map->offset   = %zu.\n"\
   "map->readonly = %s.\n"
  #define MEMMAP_DUMP_ARGS_(Map, Err) \
   Err,\
   (void*)Map->ptr,\
   Map->size,\
+  Map->offset,\
   Map->readonly ? "ReadOnly" : "ReadWrite"
 #endif
 
@@ -145,6 +282,28 @@ SSC_MemMap_mapOrDie(SSC_MemMap* map, bool readonly)
 }
 /*=========================================================================================*/
 
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Assuming @map->file (and @map->windows_filemap, if applicable) is initialized,
+ * attempt to map @size bytes of the file beginning at the file offset @offset into memory.
+ * @offset need not be aligned; the mapping is aligned internally to the page size
+ * (the allocation granularity on Windows), so @map->base holds the aligned base address
+ * and @map->ptr points at the byte corresponding to @offset.
+ * @flags are SSC_MEMMAP_MAP_* flags. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_mapRange(SSC_MemMap* map, size_t offset, size_t size, SSC_BitFlag_t flags);
+
+SSC_INLINE void
+SSC_MemMap_mapRangeOrDie(SSC_MemMap* map, size_t offset, size_t size, SSC_BitFlag_t flags)
+{
+  SSC_assertMsg(
+   !SSC_MemMap_mapRange(map, offset, size, flags),
+   "Error: SSC_MemMap_mapRange() failed to map %zu bytes at offset %zu into memory!\n",
+   size,
+   offset);
+}
+/*=========================================================================================*/
+
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 /* Attempt to unmap @map->file from memory. */
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
@@ -161,12 +320,67 @@ SSC_MemMap_unmapOrDie(SSC_MemMap* map)
 }
 /*=========================================================================================*/
 
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Change the size of @map to @size bytes, beginning at @map->ptr.
+ * Unless @map is readonly, the size of @map->file is set to (@map->offset + @size).
+ * On Linux the mapping is resized with mremap(), in place where the address space allows;
+ * elsewhere it is unmapped and mapped again. Anonymous memory is copied when it cannot be
+ * resized in place. Either way @map->ptr may change, so pointers into @map must be
+ * recomputed afterwards. On failure @map is left mapped at its old size, where possible.
+ * Files backing huge-page maps are sized in whole huge pages. Pagefile-backed memory cannot
+ * be resized on Windows. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_resize(SSC_MemMap* map, size_t size);
+
+SSC_INLINE void
+SSC_MemMap_resizeOrDie(SSC_MemMap* map, size_t size)
+{
+  SSC_assertMsg(
+   !SSC_MemMap_resize(map, size),
+   MEMMAP_DUMP_,
+   MEMMAP_DUMP_ARGS_(map, "SSC_MemMap_resize() failed to resize a memory-map"));
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Ensure @map is at least @size bytes, growing it geometrically (doubling its size) with
+ * SSC_MemMap_resize() when it is not. Appending writers that reserve before each write
+ * remap only a logarithmic number of times; they should track their own logical length,
+ * and may SSC_MemMap_resize() down to it when they finish. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_reserve(SSC_MemMap* map, size_t size);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Synchronization Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  /* Schedule the writeback and return without waiting for it to complete. (MS_ASYNC)
+   * By default synchronization blocks until the data reaches the filesystem. (MS_SYNC) */
+  SSC_MEMMAP_SYNC_ASYNC = 0x01,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Synchronize the @size bytes at (@map->ptr + @offset) with the filesystem, according
+ * to the SSC_MEMMAP_SYNC_* flags @flags. The range is widened outward to page boundaries.
+ * Only the pages in the range are written back, so small updates to large maps are cheap. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_syncRange(const SSC_MemMap* map, size_t offset, size_t size, SSC_BitFlag_t flags);
+/*=========================================================================================*/
+
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 /* Synchronize mapped memory with the filesystem. */
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 SSC_INLINE SSC_Error_t
 SSC_MemMap_sync(const SSC_MemMap* map)
-SSC_MEMMAP_SYNC_IMPL(map)
+{
+  return SSC_MemMap_syncRange(map, 0, map->size, 0);
+}
 
 SSC_INLINE void
 SSC_MemMap_syncOrDie(const SSC_MemMap* map)
@@ -178,6 +392,161 @@ SSC_MemMap_syncOrDie(const SSC_MemMap* map)
 }
 /*=========================================================================================*/
 
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Dirty Range Tracker
+ *   Divides a mapping into @chunk_count chunks of @chunk_size bytes, and remembers which
+ *   chunks were modified, so that only those need be synchronized.
+ *   A tracker is not safe to mark from several threads at once. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  uint64_t* bits;        /* One bit per chunk; set when the chunk is dirty. */
+  size_t    chunk_size;  /* The number of bytes tracked by each bit. */
+  size_t    chunk_count; /* The number of chunks tracked. */
+} SSC_MemMapDirty;
+#define SSC_MEMMAPDIRTY_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MemMapDirty, SSC_NULL, 0, 0)
+
+/* Track @size bytes in chunks of @chunk_size bytes. All chunks begin clean.
+ * When @chunk_size is 0 the page size is used. Larger chunks use less memory
+ * but synchronize more clean bytes. */
+SSC_API SSC_Error_t
+SSC_MemMapDirty_init(SSC_MemMapDirty* dirty, size_t size, size_t chunk_size);
+
+/* Mark the @size bytes at offset @offset dirty.
+ * Fails when the range exceeds the tracked size. */
+SSC_API SSC_Error_t
+SSC_MemMapDirty_mark(SSC_MemMapDirty* dirty, size_t offset, size_t size);
+
+/* Synchronize each run of consecutive dirty chunks of @map with one SSC_MemMap_syncRange()
+ * call, according to the SSC_MEMMAP_SYNC_* flags @flags, and mark them clean.
+ * On failure, the chunks that were not synchronized remain dirty. */
+SSC_API SSC_Error_t
+SSC_MemMapDirty_flush(SSC_MemMapDirty* R_ dirty, const SSC_MemMap* R_ map, SSC_BitFlag_t flags);
+
+/* Free the memory of @dirty. */
+SSC_API void
+SSC_MemMapDirty_del(SSC_MemMapDirty* dirty);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Access Pattern Advice
+ *     SSC_MemMapAdvice_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_MEMMAP_ADVICE_NORMAL     = 0, /* No special treatment. (The OS default readahead.) */
+  SSC_MEMMAP_ADVICE_SEQUENTIAL = 1, /* Pages will be accessed in ascending order; read ahead aggressively. */
+  SSC_MEMMAP_ADVICE_RANDOM     = 2, /* Pages will be accessed in random order; don't read ahead. */
+  SSC_MEMMAP_ADVICE_WILLNEED   = 3, /* Pages will be accessed soon; begin reading them in now. */
+  SSC_MEMMAP_ADVICE_DONTNEED   = 4, /* Pages won't be accessed soon; they may be evicted. */
+};
+typedef int SSC_MemMapAdvice_t;
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Advise the OS that the @size bytes at (@map->ptr + @offset) will be accessed according
+ * to @advice. The range is widened to page boundaries.
+ * Uses madvise() (or posix_madvise()) on Unixlikes. On Windows WILLNEED prefetches the
+ * range (Windows 8 and later), DONTNEED trims it from the working set, and the other
+ * advice is accepted but has no effect. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_adviseRange(const SSC_MemMap* map, size_t offset, size_t size, SSC_MemMapAdvice_t advice);
+
+/* Advise the OS that the whole of @map will be accessed according to @advice. */
+SSC_INLINE SSC_Error_t
+SSC_MemMap_advise(const SSC_MemMap* map, SSC_MemMapAdvice_t advice)
+{
+  return SSC_MemMap_adviseRange(map, 0, map->size, advice);
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Place the whole of @map on NUMA nodes according to @policy over the node mask @nodes.
+ * (See SSC_Numa_setRangePolicy().) Set the policy before first touching the memory, so that
+ * no pages need to migrate. Has no effect on Windows, or where NUMA is unsupported. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_INLINE SSC_Error_t
+SSC_MemMap_setNumaPolicy(const SSC_MemMap* map, SSC_NumaPolicy_t policy, uint64_t nodes)
+{
+  return SSC_Numa_setRangePolicy(map->ptr, map->size, policy, nodes);
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Fault in the pages covering the @size bytes at (@map->ptr + @offset), so that
+ * accessing them later does not incur page faults.
+ * Uses MADV_POPULATE_READ where available (MADV_POPULATE_WRITE for writable anonymous
+ * memory), and otherwise reads one byte of every page, spread over one thread per online
+ * processor as SSC_MemMap_prefetch() does. The contents of the mapping are never modified. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_prefault(const SSC_MemMap* map, size_t offset, size_t size);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Prefetch Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  /* Fault the pages in with SSC_MemMap_prefault(), waiting for them to be read.
+   * By default each chunk is only advised SSC_MEMMAP_ADVICE_WILLNEED, which starts
+   * reading it without waiting. */
+  SSC_MEMMAP_PREFETCH_TOUCH = 0x01,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Prefetch the @size bytes at (@map->ptr + @offset) using @threads threads at once, so
+ * that many reads are in flight and fast storage is kept busy. The range is split into
+ * chunks that the threads claim one at a time. The calling thread is one of the @threads;
+ * when @threads is 0, one thread per online processor is used.
+ * If @progress is not SSC_NULL, the calling thread calls @progress(done, total, @progress_arg)
+ * with the number of bytes prefetched so far after each chunk it completes, and once all
+ * bytes are done. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef void (*SSC_MemMapProgress_f)(size_t done, size_t total, void* arg);
+
+SSC_API SSC_Error_t
+SSC_MemMap_prefetch(
+ const SSC_MemMap* R_ map,
+ size_t               offset,
+ size_t               size,
+ unsigned             threads,
+ SSC_BitFlag_t        flags,
+ SSC_MemMapProgress_f progress,
+ void* R_             progress_arg);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Determine which of the pages covering the @size bytes at (@map->ptr + @offset) are
+ * resident in memory, without faulting any of them in. (mincore() / QueryWorkingSetEx())
+ * The number of resident pages is stored in @resident, and the number of pages queried in
+ * @total (either may be SSC_NULL). If @bitmap is not SSC_NULL, bit i of @bitmap (bit i % 8
+ * of byte i / 8) is set when page i is resident; it must hold at least
+ * SSC_MemMap_residencyBitmapSize() bytes.
+ * On Windows only pages in this process's working set are reported resident; pages that are
+ * in the system file cache but not yet mapped are not. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMap_residency(
+ const SSC_MemMap* R_ map,
+ size_t               offset,
+ size_t               size,
+ size_t* R_           resident,
+ size_t* R_           total,
+ uint8_t* R_          bitmap);
+
+/* How many bytes must a bitmap passed to SSC_MemMap_residency() for the same range hold? */
+SSC_INLINE size_t
+SSC_MemMap_residencyBitmapSize(const SSC_MemMap* map, size_t offset, size_t size)
+{
+  const uintptr_t page_mask = (uintptr_t)SSC_getPageSize() - 1;
+  const uintptr_t begin = (uintptr_t)(map->ptr + offset) & ~page_mask;
+  const uintptr_t end   = ((uintptr_t)(map->ptr + offset) + size + page_mask) & ~page_mask;
+  const size_t    pages = (size_t)(end - begin) / (size_t)(page_mask + 1);
+  return (pages + 7) / 8;
+}
+/*=========================================================================================*/
+
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 /* Unmap memory and close opened files. */
 /*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
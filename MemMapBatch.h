@@ -0,0 +1,71 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define the loading of many files at once for reading. Each file costs
+ * only an open, a size query, a map (or read) and a close: there is no existence probe,
+ * and no descriptor is held once a file is loaded. Small files may be packed into one
+ * contiguous heap buffer instead of each occupying at least a page of its own mapping. */
+#ifndef SSC_MEMMAPBATCH_H
+#define SSC_MEMMAPBATCH_H
+
+#include <stdbool.h>
+
+#include "Error.h"
+#include "File.h"
+#include "Macro.h"
+#include "MemMap.h"
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Batch File */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  const uint8_t* ptr;  /* The contents of the file. */
+  size_t         size; /* The size of the file, in bytes. */
+  SSC_MemMap     map;  /* The file's own mapping; unused (@map.ptr is SSC_NULL) when packed. */
+  bool           ok;   /* Was the file loaded? */
+} SSC_MemMapBatchFile;
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Batch */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  SSC_MemMapBatchFile* files;     /* One per path, in the order given. */
+  size_t               count;     /* The number of @files. */
+  size_t               failed;    /* The number of @files that failed to load. */
+  uint8_t*             pack;      /* The buffer small files are packed into, or SSC_NULL. */
+  size_t               pack_size; /* The number of bytes used in @pack. */
+} SSC_MemMapBatch;
+#define SSC_MEMMAPBATCH_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MemMapBatch, SSC_NULL, 0, 0, SSC_NULL, 0)
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Load the @count files at @paths readonly. Files of at most @pack_max bytes are read into
+ * @batch->pack; larger files are mapped with the SSC_MEMMAP_MAP_* flags @flags.
+ * (SSC_MEMMAP_MAP_READONLY is implied.) A @pack_max of 0 maps every nonempty file.
+ * Files that fail to load are marked so, and counted in @batch->failed; the rest are
+ * still loaded. Fails only when memory for @batch cannot be allocated. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMapBatch_init(
+ SSC_MemMapBatch* R_      batch,
+ const char* const* R_    paths,
+ size_t                   count,
+ size_t                   pack_max,
+ SSC_BitFlag_t            flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Unmap every mapped file and free the pack buffer. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void
+SSC_MemMapBatch_del(SSC_MemMapBatch* batch);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_MEMMAPBATCH_H */
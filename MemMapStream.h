@@ -0,0 +1,115 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define a cursor that streams through a file one fixed-size
+ * memory-mapped window at a time, so that files much larger than memory can be
+ * scanned sequentially with a bounded amount of address space. */
+#ifndef SSC_MEMMAPSTREAM_H
+#define SSC_MEMMAPSTREAM_H
+
+#include <stdbool.h>
+
+#include "Error.h"
+#include "File.h"
+#include "Macro.h"
+#include "MemMap.h"
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Memory Map Stream
+ *   @map holds the current window: @map.ptr, @map.size and @map.offset describe
+ *   which bytes of the file are currently accessible. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  SSC_MemMap    map;       /* The currently mapped window. */
+  size_t        file_size; /* The size of the streamed file in bytes. */
+  size_t        window;    /* The maximum number of bytes mapped at once. */
+  size_t        overlap;   /* The number of bytes each window shares with the window before it. */
+  size_t        next;      /* The file offset where the next window begins. */
+  SSC_BitFlag_t flags;     /* The SSC_MEMMAP_MAP_* flags used to map each window. */
+} SSC_MemMapStream;
+#define SSC_MEMMAPSTREAM_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_MemMapStream, SSC_MEMMAP_NULL_LITERAL, 0, 0, 0, 0, 0)
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* SSC_MemMapStream_next() Codes
+ *     SSC_CodeError_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_MEMMAPSTREAM_CODE_OK        =  0, /* The next window was mapped. */
+  SSC_MEMMAPSTREAM_CODE_END       =  1, /* There are no more windows; nothing is mapped. */
+  SSC_MEMMAPSTREAM_CODE_ERR_UNMAP = -1, /* Failed to unmap the previous window. */
+  SSC_MEMMAPSTREAM_CODE_ERR_MAP   = -2, /* Failed to map the next window. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Open the file at @filepath for streaming in windows of @window bytes.
+ * Consecutive windows share @overlap bytes, so that records up to @overlap bytes long
+ * are always wholly contained by some window. (@overlap < @window)
+ * Nothing is mapped until the first call to SSC_MemMapStream_next(). */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMapStream_init(
+ SSC_MemMapStream* R_ stream,
+ const char* R_       filepath,
+ size_t               window,
+ size_t               overlap,
+ bool                 readonly);
+
+SSC_INLINE void
+SSC_MemMapStream_initOrDie(
+ SSC_MemMapStream* R_ stream,
+ const char* R_       filepath,
+ size_t               window,
+ size_t               overlap,
+ bool                 readonly)
+{
+  SSC_assertMsg(
+   !SSC_MemMapStream_init(stream, filepath, window, overlap, readonly),
+   "Error: SSC_MemMapStream_init() failed to open %s for streaming!\n",
+   filepath);
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Unmap the current window (if any) and map the next one.
+ * The window is advised as sequential, and the OS is advised to begin reading the window after it. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_MemMapStream_next(SSC_MemMapStream* stream);
+/* -> SSC_MEMMAPSTREAM_CODE_OK : @stream->map holds the next window.
+ * -> SSC_MEMMAPSTREAM_CODE_END: The end of the file was reached.
+ * -> Negative                 : An error occurred. */
+
+SSC_INLINE bool
+SSC_MemMapStream_nextOrDie(SSC_MemMapStream* stream)
+{
+  const SSC_CodeError_t c = SSC_MemMapStream_next(stream);
+  SSC_assertMsg(c >= 0, "Error: SSC_MemMapStream_next() failed with code %d!\n", c);
+  return c == SSC_MEMMAPSTREAM_CODE_OK;
+}
+/* -> true : A window was mapped.
+ * -> false: The end of the file was reached. */
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Restart streaming from the file offset @offset. The current window is unmapped. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_MemMapStream_seek(SSC_MemMapStream* stream, size_t offset);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Unmap the current window and close the streamed file. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void
+SSC_MemMapStream_del(SSC_MemMapStream* stream);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_MEMMAPSTREAM_H */
@@ -28,6 +28,8 @@
  #define SSC_ALIGNED_FREE_IS_POSIX_FREE
  /* SSC_getPageSize */
  #define SSC_GET_PAGE_SIZE_IMPL { return (size_t)sysconf(_SC_PAGESIZE); }
+ /* SSC_getAllocationGranularity */
+ #define SSC_GET_ALLOCATION_GRANULARITY_IMPL { return SSC_getPageSize(); }
 #elif defined(SSC_OS_WINDOWS)
  #include <malloc.h>
  #include <sysinfoapi.h>
@@ -41,6 +43,12 @@
   GetSystemInfo(&si);\
   return (size_t)si.dwPageSize;\
  }
+ /* SSC_getAllocationGranularity */
+ #define SSC_GET_ALLOCATION_GRANULARITY_IMPL {\
+  SYSTEM_INFO si;\
+  GetSystemInfo(&si);\
+  return (size_t)si.dwAllocationGranularity;\
+ }
 #else
  #error "Unsupported."
 #endif
@@ -73,6 +81,12 @@ SSC_INLINE size_t
 SSC_getPageSize(void)
 SSC_GET_PAGE_SIZE_IMPL
 
+/* Get the granularity that file offsets of memory-maps must be aligned to.
+ * On Unixlikes this is the page size; on Windows it is usually 64KiB. */
+SSC_INLINE size_t
+SSC_getAllocationGranularity(void)
+SSC_GET_ALLOCATION_GRANULARITY_IMPL
+
 /* Allocate @n bytes on the heap successfully, or terminate the program. */
 SSC_INLINE void*
 SSC_mallocOrDie(size_t n)
@@ -0,0 +1,97 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define procedures for controlling which NUMA nodes memory is placed on,
+ * and for querying where it was placed. Nodes are named by bit positions in a uint64_t mask,
+ * so only the first 64 nodes may be addressed.
+ * Placement is applied with mbind() and set_mempolicy() on Linux. Elsewhere setting a policy
+ * succeeds without effect, and every resident page is reported to be on node 0. */
+#ifndef SSC_NUMA_H
+#define SSC_NUMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Error.h"
+#include "Macro.h"
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Placement Policies
+ *     SSC_NumaPolicy_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_NUMA_POLICY_DEFAULT    = 0, /* Place pages on the node of the thread that first touches them. */
+  SSC_NUMA_POLICY_BIND       = 1, /* Place pages only on the nodes in @nodes. */
+  SSC_NUMA_POLICY_INTERLEAVE = 2, /* Spread pages round-robin across the nodes in @nodes. */
+  SSC_NUMA_POLICY_PREFERRED  = 3, /* Place pages on the lowest node in @nodes, or elsewhere when it is full. */
+};
+typedef int SSC_NumaPolicy_t;
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Get the number of NUMA nodes the system may have. Returns 1 where NUMA is unsupported. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API unsigned
+SSC_Numa_getNodeCount(void);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Apply @policy over the node mask @nodes to the @size bytes at @ptr, widened to page
+ * boundaries. Pages this process already touched are migrated where possible.
+ * The policy governs anonymous, shared (shm/memfd) and copied-on-write pages; the kernel
+ * places the page cache of regular files itself. @nodes is ignored by SSC_NUMA_POLICY_DEFAULT. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_Numa_setRangePolicy(void* ptr, size_t size, SSC_NumaPolicy_t policy, uint64_t nodes);
+
+/* Apply @policy over @nodes to memory the calling thread touches first from now on. */
+SSC_API SSC_Error_t
+SSC_Numa_setThreadPolicy(SSC_NumaPolicy_t policy, uint64_t nodes);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Return a pointer to @size bytes of zeroed memory aligned to @alignment (and to at least the
+ * page size), to be placed according to @policy over @nodes. The memory is mapped directly,
+ * rather than taken from the heap, so that no other allocation shares its pages.
+ * On Windows, BIND and PREFERRED prefer the lowest node in @nodes, and INTERLEAVE has no effect.
+ * Free the memory with SSC_Numa_alignedFree(), passing the same @size. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void*
+SSC_Numa_alignedMalloc(size_t alignment, size_t size, SSC_NumaPolicy_t policy, uint64_t nodes);
+/* On failure, return SSC_NULL. */
+
+SSC_INLINE void*
+SSC_Numa_alignedMallocOrDie(size_t alignment, size_t size, SSC_NumaPolicy_t policy, uint64_t nodes)
+{
+  void* p = SSC_Numa_alignedMalloc(alignment, size, policy, nodes);
+  SSC_assertMsg(p != SSC_NULL, "Error: SSC_Numa_alignedMallocOrDie died!\n");
+  return p;
+}
+
+/* Free the @size bytes at @p, allocated with SSC_Numa_alignedMalloc*. */
+SSC_API void
+SSC_Numa_alignedFree(void* p, size_t size);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Count the resident pages of the @size bytes at @ptr, widened to page boundaries, by the node
+ * that backs them: @per_node[i] is increased by the number on node i, for i < @node_count.
+ * Pages that are not resident, or are on nodes past @node_count, are not counted.
+ * Pages are not faulted in by the query. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_Numa_getRangeNodes(const void* R_ ptr, size_t size, size_t* R_ per_node, unsigned node_count);
+
+/* Return the node backing the page at @ptr, or -1 when it is not resident. */
+SSC_API int
+SSC_Numa_getNode(const void* ptr);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_NUMA_H */
@@ -0,0 +1,181 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define an array of fixed-size records stored in a memory-mapped file.
+ * The file begins with a self-describing header, followed immediately by the records:
+ *
+ *   Offset | Size | Field
+ *   -------+------+------------------------------------------------------------
+ *        0 |    8 | Magic bytes, "SSCRECAR".
+ *        8 |    4 | Format version. (SSC_RECORDARRAY_VERSION)
+ *       12 |    4 | Byte order of the records' contents. (SSC_RECORDARRAY_*_ENDIAN)
+ *       16 |    8 | Record size, in bytes.
+ *       24 |    8 | Record count.
+ *       32 |   32 | Reserved; zero.
+ *
+ * Header fields are always little endian. Records are accessed in place; use
+ * SSC_loadLittleEndian* and SSC_storeLittleEndian* (or their big endian counterparts,
+ * according to SSC_RecordArray_isBigEndian()) to read and write their fields. */
+#ifndef SSC_RECORDARRAY_H
+#define SSC_RECORDARRAY_H
+
+#include <stdbool.h>
+
+#include "Error.h"
+#include "Macro.h"
+#include "MemMap.h"
+#include "Memory.h"
+
+#define SSC_RECORDARRAY_HEADER_SIZE 64 /* Records begin at this file offset. */
+#define SSC_RECORDARRAY_VERSION     1
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Record Array */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  SSC_MemMap map;         /* The mapped file; the header is at @map.ptr. */
+  size_t     record_size; /* The size of each record, in bytes. */
+  size_t     count;       /* The number of records. */
+} SSC_RecordArray;
+#define SSC_RECORDARRAY_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_RecordArray, SSC_MEMMAP_NULL_LITERAL, 0, 0)
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Record Byte Orders */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_RECORDARRAY_LITTLE_ENDIAN = 0,
+  SSC_RECORDARRAY_BIG_ENDIAN    = 1,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_RECORDARRAY_INIT_READONLY   = 0x01, /* Open an existing array readonly. */
+  SSC_RECORDARRAY_INIT_BIG_ENDIAN = 0x02, /* Declare a new array's records big endian. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Error Codes
+ *     SSC_CodeError_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_RECORDARRAY_INIT_CODE_OK              =  0,
+  SSC_RECORDARRAY_INIT_CODE_ERR_MAP         = -1, /* Failed to create, open or map the file. */
+  SSC_RECORDARRAY_INIT_CODE_ERR_MAGIC       = -2, /* The file is not a record array. */
+  SSC_RECORDARRAY_INIT_CODE_ERR_VERSION     = -3, /* The file's format version is unsupported. */
+  SSC_RECORDARRAY_INIT_CODE_ERR_RECORD_SIZE = -4, /* The record size is zero, or differs from the file's. */
+  SSC_RECORDARRAY_INIT_CODE_ERR_CORRUPT     = -5, /* The file is too small for its header's record count. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Open the record array at @filepath, creating an empty one with records of @record_size
+ * bytes if there is no file there; when creating it fails, the new file is removed.
+ * When opening an existing array, a @record_size of 0 accepts the file's record size;
+ * otherwise it must match. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_RecordArray_init(
+ SSC_RecordArray* R_ arr,
+ const char* R_      filepath,
+ size_t              record_size,
+ SSC_BitFlag_t       flags);
+
+SSC_API void
+SSC_RecordArray_initOrDie(
+ SSC_RecordArray* R_ arr,
+ const char* R_      filepath,
+ size_t              record_size,
+ SSC_BitFlag_t       flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Access the records. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Return the number of records in @arr. */
+SSC_INLINE size_t
+SSC_RecordArray_count(const SSC_RecordArray* arr)
+{
+  return arr->count;
+}
+
+/* Are the records of @arr big endian? */
+SSC_INLINE bool
+SSC_RecordArray_isBigEndian(const SSC_RecordArray* arr)
+{
+  return SSC_loadLittleEndian32(arr->map.ptr + 12) == SSC_RECORDARRAY_BIG_ENDIAN;
+}
+
+/* Return a pointer to record @i of @arr, or SSC_NULL if @i is out of bounds.
+ * The pointer is invalidated by SSC_RecordArray_append(). */
+SSC_INLINE uint8_t*
+SSC_RecordArray_at(const SSC_RecordArray* arr, size_t i)
+{
+  if (i >= arr->count)
+    return SSC_NULL;
+  return arr->map.ptr + SSC_RECORDARRAY_HEADER_SIZE + (i * arr->record_size);
+}
+
+SSC_INLINE uint8_t*
+SSC_RecordArray_atOrDie(const SSC_RecordArray* arr, size_t i)
+{
+  uint8_t* p = SSC_RecordArray_at(arr, i);
+  SSC_assertMsg(p != SSC_NULL, "Error: SSC_RecordArray_atOrDie(): Index %zu is out of bounds (%zu)!\n", i, arr->count);
+  return p;
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Append a zeroed record to @arr, and return a pointer to it, or SSC_NULL on failure.
+ * The file grows geometrically (see SSC_MemMap_reserve()), so appends take amortized O(1)
+ * time; each growth may move the mapping and invalidate pointers to records.
+ * If @record is not SSC_NULL, its @arr->record_size bytes are copied into the new record. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API uint8_t*
+SSC_RecordArray_append(SSC_RecordArray* R_ arr, const void* R_ record);
+
+SSC_INLINE uint8_t*
+SSC_RecordArray_appendOrDie(SSC_RecordArray* R_ arr, const void* R_ record)
+{
+  uint8_t* p = SSC_RecordArray_append(arr, record);
+  SSC_assertMsg(p != SSC_NULL, "Error: SSC_RecordArray_append() failed!\n");
+  return p;
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Remove every record at index @count and above from @arr. (@count <= @arr->count) */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_Error_t
+SSC_RecordArray_truncate(SSC_RecordArray* arr, size_t count);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Synchronize the header and records of @arr with the filesystem. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_INLINE SSC_Error_t
+SSC_RecordArray_sync(const SSC_RecordArray* arr)
+{
+  return SSC_MemMap_syncRange(&arr->map, 0, SSC_RECORDARRAY_HEADER_SIZE + (arr->count * arr->record_size), 0);
+}
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Trim the file of a writable @arr to the size of its records, then unmap and close it. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void
+SSC_RecordArray_del(SSC_RecordArray* arr);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_RECORDARRAY_H */
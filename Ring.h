@@ -0,0 +1,141 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define a lock-free single-producer/single-consumer ring buffer of
+ * fixed-size slots, stored in shared memory so that the producer and consumer may be
+ * different processes.
+ *
+ *   Offset | Size | Field
+ *   -------+------+------------------------------------------------------------
+ *        0 |    8 | Magic bytes, "SSCRING1"; stored last, once the ring is ready.
+ *        8 |    4 | Slot size, in bytes.
+ *       12 |    4 | Reserved; zero.
+ *       16 |    8 | Slot count; a power of 2.
+ *      128 |    8 | Head: the number of slots ever produced.
+ *      256 |    8 | Tail: the number of slots ever consumed.
+ *      384 |  ... | Slots.
+ *
+ * The slot size and count are little endian. The head and tail are native endian, since
+ * every process sharing a ring runs on the same machine. They are kept on separate cache
+ * line pairs, so that the producer and consumer don't contend for them (or for lines that
+ * adjacent-line prefetchers bring in alongside them). */
+#ifndef SSC_RING_H
+#define SSC_RING_H
+
+#include <stdbool.h>
+
+#include "Error.h"
+#include "Macro.h"
+#include "MemMap.h"
+
+#define SSC_RING_HEADER_SIZE 384 /* The first slot begins at this offset. */
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Ring Buffer
+ *   Each process holds its own SSC_Ring over the shared mapping. Exactly one process
+ *   (or thread) may produce, and exactly one may consume. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+typedef struct {
+  SSC_MemMap         map;
+  uint8_t*           slots;      /* The first slot. */
+  volatile uint64_t* head;       /* The shared head. */
+  volatile uint64_t* tail;       /* The shared tail. */
+  size_t             slot_size;  /* The size of each slot, in bytes. */
+  uint64_t           mask;       /* The slot count, minus 1. */
+  uint64_t           seen_head;  /* The consumer's last view of @head. */
+  uint64_t           seen_tail;  /* The producer's last view of @tail. */
+} SSC_Ring;
+#define SSC_RING_NULL_LITERAL SSC_COMPOUND_LITERAL(SSC_Ring, SSC_MEMMAP_NULL_LITERAL, SSC_NULL, SSC_NULL, SSC_NULL, 0, 0, 0, 0)
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Flags
+ *     SSC_BitFlag_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  /* @name is a filesystem path, rather than the name of a shared memory object.
+   * See SSC_MemMap_init() and SSC_MemMap_initShared(). */
+  SSC_RING_INIT_FILEPATH = 0x01,
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Initialization Error Codes
+ *     SSC_CodeError_t */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+enum {
+  SSC_RING_INIT_CODE_OK            =  0,
+  SSC_RING_INIT_CODE_ERR_MAP       = -1, /* Failed to create, open or map the memory. */
+  SSC_RING_INIT_CODE_ERR_GEOMETRY  = -2, /* The slot size or slot count is invalid. */
+  SSC_RING_INIT_CODE_ERR_NOT_READY = -3, /* The ring is not a ring, or its creator hasn't finished. */
+};
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Create a new, empty ring of @slot_count slots of @slot_size bytes at @name, failing if
+ * it already exists. @slot_count must be a power of 2. When @name is SSC_NULL, the ring is
+ * anonymous, and is shared with children across fork(). */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API SSC_CodeError_t
+SSC_Ring_create(
+ SSC_Ring* R_   ring,
+ const char* R_ name,
+ size_t         slot_size,
+ size_t         slot_count,
+ SSC_BitFlag_t  flags);
+
+/* Open the existing ring at @name, which must not be SSC_NULL. Returns
+ * SSC_RING_INIT_CODE_ERR_NOT_READY while its creator is still initializing it; the caller
+ * may retry. */
+SSC_API SSC_CodeError_t
+SSC_Ring_open(SSC_Ring* R_ ring, const char* R_ name, SSC_BitFlag_t flags);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Batch Production
+ *   SSC_Ring_writeBegin() returns how many empty slots, up to @n, follow *@first
+ *   contiguously. The producer fills some number of them and publishes them all at once
+ *   with SSC_Ring_writeEnd(). Wrapping around the end of the ring takes two batches. */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API size_t
+SSC_Ring_writeBegin(SSC_Ring* R_ ring, size_t n, uint8_t** R_ first);
+
+SSC_API void
+SSC_Ring_writeEnd(SSC_Ring* ring, size_t n);
+
+/* Copy the @ring->slot_size bytes at @slot into the ring. Return false when the ring is full. */
+SSC_API bool
+SSC_Ring_push(SSC_Ring* R_ ring, const void* R_ slot);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Batch Consumption
+ *   SSC_Ring_readBegin() returns how many full slots, up to @n, follow *@first
+ *   contiguously. The consumer reads some number of them and releases them all at once
+ *   with SSC_Ring_readEnd(). */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API size_t
+SSC_Ring_readBegin(SSC_Ring* R_ ring, size_t n, const uint8_t** R_ first);
+
+SSC_API void
+SSC_Ring_readEnd(SSC_Ring* ring, size_t n);
+
+/* Copy the next slot out of the ring into @slot. Return false when the ring is empty. */
+SSC_API bool
+SSC_Ring_pop(SSC_Ring* R_ ring, void* R_ slot);
+/*=========================================================================================*/
+
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+/* Unmap the ring. A named ring persists until it is unlinked. (See SSC_MemMap_unlinkShared().) */
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+SSC_API void
+SSC_Ring_del(SSC_Ring* ring);
+/*=========================================================================================*/
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_RING_H */
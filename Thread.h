@@ -0,0 +1,74 @@
+/* Copyright (c) 2020-2024 Stuart Steven Calder
+ * See accompanying LICENSE file for licensing information.
+ *
+ * In this file, we define procedures for starting and joining threads,
+ * and determining how many processors the OS makes available. */
+#ifndef SSC_THREAD_H
+#define SSC_THREAD_H
+
+#include <stdlib.h>
+
+#include "Error.h"
+#include "Macro.h"
+
+#if defined(SSC_OS_UNIXLIKE)
+ #include <pthread.h>
+ #include <unistd.h>
+ /* SSC_getProcessorCount */
+ #define SSC_GET_PROCESSOR_COUNT_IMPL {\
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);\
+  return (n > 0) ? (unsigned)n : 1u;\
+ }
+#elif defined(SSC_OS_WINDOWS)
+ #include <windows.h>
+ /* SSC_getProcessorCount */
+ #define SSC_GET_PROCESSOR_COUNT_IMPL {\
+  SYSTEM_INFO si;\
+  GetSystemInfo(&si);\
+  return (unsigned)si.dwNumberOfProcessors;\
+ }
+#else
+ #error "Unsupported operating system."
+#endif
+
+#define R_ SSC_RESTRICT
+SSC_BEGIN_C_DECLS
+
+#if   defined(SSC_OS_UNIXLIKE)
+typedef pthread_t SSC_Thread_t;
+#elif defined(SSC_OS_WINDOWS)
+typedef HANDLE    SSC_Thread_t;
+#endif
+
+/* The procedure a thread runs, passed the argument given to SSC_Thread_create(). */
+typedef void (*SSC_ThreadFunc_f)(void* arg);
+
+/* Get the number of processors currently online. */
+SSC_INLINE unsigned
+SSC_getProcessorCount(void)
+SSC_GET_PROCESSOR_COUNT_IMPL
+
+/* Start a thread running @func(@arg), storing its handle in @thread. */
+SSC_API SSC_Error_t
+SSC_Thread_create(SSC_Thread_t* R_ thread, SSC_ThreadFunc_f func, void* R_ arg);
+
+SSC_INLINE void
+SSC_Thread_createOrDie(SSC_Thread_t* R_ thread, SSC_ThreadFunc_f func, void* R_ arg)
+{
+  SSC_assertMsg(!SSC_Thread_create(thread, func, arg), "Error: SSC_Thread_create() failed!\n");
+}
+
+/* Wait for @thread to return, and release its resources. */
+SSC_API SSC_Error_t
+SSC_Thread_join(SSC_Thread_t thread);
+
+SSC_INLINE void
+SSC_Thread_joinOrDie(SSC_Thread_t thread)
+{
+  SSC_assertMsg(!SSC_Thread_join(thread), "Error: SSC_Thread_join() failed!\n");
+}
+
+SSC_END_C_DECLS
+#undef R_
+
+#endif /* ~ SSC_THREAD_H */